@@ -1,4 +1,236 @@
-#include "bimatrix.h"
+#include "algorithm.h"
+
+/*
+  Thread pool shared by the pivoting kernels. When it is set, the pivots on tableaus of at least
+  PIVOT_PARALLEL_MIN coefficients split their rows among the threads; smaller ones stay serial,
+  because waking the threads would cost more than the pivot. A tuning profile can move the threshold.
+*/
+
+static thread_pool* pivot_pool = 0;
+static long pivot_parallel_min = PIVOT_PARALLEL_MIN;
+static long ratio_parallel_min = RATIO_PARALLEL_MIN;
+
+void set_parallel_thresholds(long pivot_min, long ratio_min) {
+  pivot_parallel_min = pivot_min;
+  ratio_parallel_min = ratio_min;
+}
+
+long get_pivot_parallel_min(void) {
+  return pivot_parallel_min;
+}
+
+void set_pivot_threads(int threads) {
+  if( pivot_pool ) {
+    pool_free(pivot_pool);
+    pivot_pool = 0;
+  }
+  if( threads > POOL_MAX_THREADS )
+    threads = POOL_MAX_THREADS;
+  if( threads > 1 )
+    pivot_pool = pool_create(threads);
+}
+
+int get_pivot_threads(void) {
+  return pivot_pool ? pool_size(pivot_pool) : 1;
+}
+
+static inline int parallel_pivot(int nlines, int width) {
+  return pivot_pool != 0 && pivot_parallel_min >= 0 && (long) nlines * width >= pivot_parallel_min;
+}
+
+//The rows from first to last (excluded) of thread t
+static inline void thread_rows(int nlines, int t, int nthreads, int* first, int* last) {
+  *first = (int) ((long) nlines * t / nthreads);
+  *last = (int) ((long) nlines * (t + 1) / nthreads);
+}
+
+typedef struct ratio_job_ {
+  double** tableau;
+  int nlines;
+  int column;
+  int index[POOL_MAX_THREADS];
+  double min[POOL_MAX_THREADS];
+} ratio_job;
+
+typedef struct pivot_job_ {
+  double** tableau;
+  int width;
+  int nlines;
+  int index;
+  int column;
+} pivot_job;
+
+//Elimination of the entering variable from the rows of thread t: the same loop of pivot_tableau
+static void pivot_worker(void* arg, int t, int nthreads) {
+  pivot_job* job = (pivot_job*) arg;
+  double** tableau = job->tableau;
+  double* prow = tableau[job->index];
+  int i, j, first, last, column = job->column;
+  double agg;
+
+  thread_rows(job->nlines, t, nthreads, &first, &last);
+
+  for (i = first; i < last; i++) {
+    if (tableau[i][column] < -eps || tableau[i][column] > eps) {
+      for (j = 1; j < job->width; j++) {
+	agg = tableau[i][column] * prow[j];
+	tableau[i][j] += agg;
+      }
+      tableau[i][column] = 0;
+    }
+  }
+}
+
+/*
+  Each thread finds the minimum ratio on its own rows, with the same rule of the serial loop. Merging
+  the results in the order of the rows gives the same row the serial loop would choose.
+*/
+
+static void ratio_worker(void* arg, int t, int nthreads) {
+  ratio_job* job = (ratio_job*) arg;
+  int i, first, last, index = -1;
+  double min = 0.0, val;
+
+  thread_rows(job->nlines, t, nthreads, &first, &last);
+
+  for(i = first; i < last; i++) {
+    if( job->tableau[i][job->column] > -eps )
+      continue;
+    val = -job->tableau[i][1] / job->tableau[i][job->column];
+    if( index < 0 || val<(min-eps)) {
+      min = val;
+      index = i;
+    }
+  }
+
+  job->index[t] = index;
+  job->min[t] = min;
+}
+
+/*
+  Minimum ratio test: we choose the index of the row in our tableau, for which the coefficient of the variable entering
+  the basis is less than zero (if it's > 0 we cannot choose this row) and so that we minimize the ratio between the value
+  of the variable in basis ( tableau[i][1] ) and the coefficient of the variable entering the basis (tableau[i][column]).
+  Returns -1 if there is no such row.
+*/
+
+int min_ratio_row(double** tableau, int nlines, int column, int debug) {
+  int i, index = -1;
+  double min = 0.0, val;
+  ratio_job job;
+  ooc_tableau* ot = ooc_find(tableau);
+
+  if( ot )
+    return ooc_min_ratio_row(ot, column);
+
+  if( pivot_pool != 0 && ratio_parallel_min >= 0 && nlines >= ratio_parallel_min && !(debug & 0x02) ) {
+    job.tableau = tableau;
+    job.nlines = nlines;
+    job.column = column;
+    pool_run(pivot_pool, ratio_worker, &job);
+
+    for(i = 0; i < pool_size(pivot_pool); i++) {
+      if( job.index[i] >= 0 && (index < 0 || job.min[i]<(min-eps)) ) {
+	min = job.min[i];
+	index = job.index[i];
+      }
+    }
+    return index;
+  }
+
+  if( debug & 0x02 )
+    fprintf(stdout,"\nMinimum ratio test:\n");
+    
+  for(i = 0; i < nlines; i++) {
+      
+    if( tableau[i][column] > -eps ) //We check that the coefficient is > 0
+      continue;
+      
+    val = -tableau[i][1] / tableau[i][column];	//Ratio
+
+    if( debug & 0x02 )
+      fprintf(stdout,"Row %d ratio = %.15lf\n",i,val);
+      
+    if( index < 0 || val<(min-eps)) { //We update the index of the row following the minimum ratio. index < 0 checks if it's the first feasible row we are trying
+      min = val;
+      index = i;
+    } 
+  }
+
+  if( debug & 0x02 )
+    fprintf(stdout,"\n");
+
+  return index;
+}
+
+/*
+  Now we know what variable will go out of the basis, so we only need to do two things:
+  - Solve the equation we chose with the minimum ratio test, updating the variable in basis 
+  - Solve all other equations of the tableau, updating all the coefficients
+  'entering' is the variable entering the basis in row 'index' (its column is 'column'), and leavecol is the column
+  of the variable leaving the basis.
+*/
+
+void pivot_tableau(double** tableau, int nlines, int width, int index, int column, int leavecol, int entering) {
+  int i, j;
+  double agg, coeff;
+  pivot_job job;
+
+  /*
+    So the first step is to update the row chosen with the minimum ratio test: we update tableau[index][0], which tells
+    what variable is in basis and we calculate the coefficient we will divide all other coefficient with.
+  */
+    
+  tableau[index][leavecol] = -1;
+  tableau[index][0] = entering;
+  coeff = -tableau[index][column];
+    
+  /* 
+     Then we update the whole row, and we put the coefficient of variable entering basis to zero.
+  */
+    
+  for (i = 1; i < width; i++)
+    tableau[index][i] /= coeff;
+  tableau[index][column] = 0;
+    
+  /*
+    The second step is to solve all other equations in the tableau:
+    - We check if the coefficient of the variable entering in basis in this row is nonzero
+    - If so, we update the coefficients, and set to zero the coefficient of the variable entering basis
+    On big tableaus the rows are split among the threads of the pool: they are independent, as the
+    row 'index' is only read (its coefficient in 'column' is already zero, so it is skipped). Out-of-core
+    tableaus visit only the blocks of rows that may have a nonzero coefficient in 'column'.
+  */
+
+  if( ooc_find(tableau) ) {
+    ooc_pivot_rows(ooc_find(tableau), index, column);
+    return;
+  }
+
+  if( parallel_pivot(nlines, width) ) {
+    job.tableau = tableau;
+    job.width = width;
+    job.nlines = nlines;
+    job.index = index;
+    job.column = column;
+    pool_run(pivot_pool, pivot_worker, &job);
+    return;
+  }
+    
+  for (i = 0; i < nlines; i++) {
+     
+    if (tableau[i][column] < -eps || tableau[i][column] > eps) {
+	
+      for (j = 1; j < width; j++) {
+	agg = tableau[i][column] * tableau[index][j];
+	tableau[i][j] += agg;
+      }
+      tableau[i][column] = 0;
+	
+    }
+      
+  }
+}
 
 // Returns the equilibrium found by the Lemke-Howson algorithm pivoting on the variable startpivot. 
 // DEBUG MASK:
@@ -7,17 +239,72 @@
 
 #define MAX_INT 1000000
 
-equilibrium* lemke_howson_gen(double*** tableaus, double** bimatrix, int dim1, int dim2, int startpivot, int* steps, int debug) {
+/*
+  Whether a row other than index has the same ratio, up to RATIO_TIE times the minimum, as the row
+  chosen by the minimum ratio test: the game is degenerate there, and the row leaving the basis is
+  chosen by the rounding of the ratios or by its order. The test does not depend on the scale of the
+  payoffs; eps only keeps a tie at a zero minimum.
+*/
+
+static int ratio_tie(double** tableau, int nlines, int column, int index) {
+  double min = -tableau[index][1] / tableau[index][column], val;
+  double tol = RATIO_TIE * fabs(min) + eps;
+  int i;
+
+  for(i = 0; i < nlines; i++) {
+    if( i == index || tableau[i][column] > -eps )
+      continue;
+    val = -tableau[i][1] / tableau[i][column];
+    if( fabs(val - min) <= tol )
+      return 1;
+  }
+  return 0;
+}
+
+/*
+  Whether a variable in the basis of the tableau is zero, up to RATIO_TIE times the largest one of the
+  same kind: the basis was reached after a tie, and the same point has other bases, from which the
+  paths can differ. The slacks (negative labels) are at most 1 and the strategies scale with the
+  inverse of the payoffs, so each kind is compared with its own largest value.
+*/
+static int degenerate_basis(double** tableau, int nlines) {
+  double max[2] = {0.0, 0.0};
+  int i, k;
+
+  for(i = 0; i < nlines; i++) {
+    k = tableau[i][0] < 0;
+    max[k] = tableau[i][1] > max[k] ? tableau[i][1] : max[k];
+  }
+  for(i = 0; i < nlines; i++) {
+    if( tableau[i][1] <= RATIO_TIE * max[tableau[i][0] < 0] )
+      return 1;
+  }
+  return 0;
+}
+
+//Hash of the basis of the two tableaus, row by row, and of the variable entering next
+static uint64_t basis_hash(double*** tableaus, int dim1, int dim2, int pivot) {
+  uint64_t h = 14695981039346656037ULL ^ (uint64_t) (int64_t) pivot;
+  int i;
+
+  for(i = 0; i < dim1; i++)
+    h = (h ^ (uint64_t) (int64_t) tableaus[0][i][0]) * 1099511628211ULL;
+  for(i = 0; i < dim2; i++)
+    h = (h ^ (uint64_t) (int64_t) tableaus[1][i][0]) * 1099511628211ULL;
+  return h;
+}
+
+equilibrium* lemke_howson_gen(double*** tableaus, double** bimatrix, int dim1, int dim2, int startpivot, int* steps, int* degenerate, int debug) {
   
-  if(debug & 0x01) { //Debug output on the execution of the algorithm
+  if((debug & 0x01) && bimatrix) { //Debug output on the execution of the algorithm (there is no bimatrix in low memory mode)
     fprintf(stdout,"Lemke-Howson algorithm execution. The following bimatrixes are modified from the randomly generated (or imported from file) to have only positive payoffs.\n");
     view_bimatrix_gen(bimatrix,dim1,dim2,stdout);
   }
 
   int newpivot;
-  double min, agg, coeff, val;
-  int i, j, index = 0;
-  int updated;
+  int i, index = 0;
+  int power = 1, lap = 0, saved = 0;
+  uint64_t h, seen = 0;
  
   /*
     startpivot is the index of the variable we want to pivot on. get_pivot determines, looking at the tableau, if we want the real
@@ -28,10 +315,31 @@ equilibrium* lemke_howson_gen(double*** tableaus, double** bimatrix, int dim1, i
   
   int pivot = get_pivot_gen(tableaus,dim1,dim2,startpivot);
   *steps = 0;
+  if( degenerate )
+    *degenerate = degenerate_basis(tableaus[0],dim1) || degenerate_basis(tableaus[1],dim2);
 
   for (;;) {
     (*steps)++;    
-    min = 0.0; updated = 0;
+
+    /*
+      After a tie, the rows chosen by their order can bring the path back to a basis it already left,
+      and around the same cycle forever. Once the path is degenerate, the basis is compared with one
+      saved at doubling intervals (Brent's method): a path seen cycling is abandoned, with *degenerate
+      set to 2.
+    */
+    if( degenerate && *degenerate ) {
+      h = basis_hash(tableaus,dim1,dim2,pivot);
+      if( saved && h == seen ) {
+	*degenerate = 2;
+	return 0;
+      }
+      if( ++lap == power ) {
+	seen = h;
+	saved = 1;
+	power *= 2;
+	lap = 0;
+      }
+    }
 
     if( debug & 0x02 ) { //Debug output of the tableaus
       fprintf(stdout,"Step no. %d. First Tableau:\n",*steps);
@@ -50,39 +358,21 @@ equilibrium* lemke_howson_gen(double*** tableaus, double** bimatrix, int dim1, i
     int column = get_column(dim1,dim2,pivot);
 
     
+    index = min_ratio_row(tableaus[ntab],nlines,column,debug);
+
     /*
-      Minimum ratio test: we choose the index of the row in our tableau, for which the coefficient of the variable entering
-      the basis is less than zero (if it's > 0 we cannot choose this row) and so that we minimize the ratio between the value
-      of the variable in basis ( tableaus[ntab][i][1] ) and the coefficient of the variable entering the basis (tableaus[ntab][i][column])
+      If we didn't find a row, this means there isn't a row for which the coefficient of the variable entering the basis
+      if less than zero. This cannot happen, so if we are in this condition, we got something wrong: a degenerate
+      path can get here after pivots on coefficients that are only rounding, and it is abandoned as one that cycles.
     */
-    if( debug & 0x02 )
-      fprintf(stdout,"\nMinimum ratio test:\n");
-    
-    for(i = 0; i < nlines; i++) {
-      
-      if( tableaus[ntab][i][column] > -eps ) //We check that the coefficient is > 0
-	continue;
-      
-      val = -tableaus[ntab][i][1] / tableaus[ntab][i][column];	//Ratio
-
-      if( debug & 0x02 )
-	fprintf(stdout,"Row %d ratio = %.15lf\n",i,val);
-      
-      if( !updated || val<(min-eps)) { //We update the index of the row following the minimum ratio. Updated checks if it's the first feasible row we are trying 	
-	min = val;
-	updated = 1;
-	index = i;
-      } 
+    if( index < 0 && degenerate && *degenerate ) {
+      *degenerate = 2;
+      return 0;
     }
+    assert(index >= 0);
 
-    if( debug & 0x02 )
-      fprintf(stdout,"\n");
-    
-    /*
-      If we didn't update the index of our row, this means there isn't a row for which the coefficient of the variable entering the basis
-      if less than zero. This cannot happen, so if we are in this condition, we got something wrong.
-    */
-    assert(updated != 0);
+    if( degenerate && !*degenerate )
+      *degenerate = ratio_tie(tableaus[ntab],nlines,column,index);
   
     //Finally we choose what variable will go out of the basis
     newpivot = (int) tableaus[ntab][index][0];
@@ -91,49 +381,7 @@ equilibrium* lemke_howson_gen(double*** tableaus, double** bimatrix, int dim1, i
       fprintf(stdout,"Step %d. Label in basis: %d. \t Label out of basis: %d.\t Index of row: %d\n",*steps,pivot,newpivot,index);
 
     
-    /*
-      Now we know what variable will go out of the basis, so we only need to do two things:
-      - Solve the equation we chose with the minimum ratio test, updating the variable in basis 
-      - Solve all other equations of the tableau, updating all the coefficients
-    */
-
-
-    /*
-      So the first step is to update the row chosen with the minimum ratio test: we update tableaus[ntab][index][0], which tells
-      what variable is in basis and we calculate the coefficient we will divide all other coefficient with.
-    */
-    
-    tableaus[ntab][index][get_column(dim1,dim2,newpivot)] = -1;
-    tableaus[ntab][index][0] = pivot;
-    coeff = -tableaus[ntab][index][column];
-    
-    /* 
-       Then we update the whole row, and we put the coefficient of variable entering basis to zero.
-    */
-    
-    for (i = 1; i < (dim1 + dim2 + 2); i++)
-      tableaus[ntab][index][i] /= coeff;
-    tableaus[ntab][index][column] = 0;
-    
-    /*
-      The second step is to solve all other equations in the tableau:
-      - We check if the coefficient of the variable entering in basis in this row is nonzero
-      - If so, we update the coefficients, and set to zero the coefficient of the variable entering basis
-    */
-    
-    for (i = 0; i < nlines; i++) {
-     
-      if (tableaus[ntab][i][column] < -eps || tableaus[ntab][i][column] > eps) {
-	
-	for (j = 1; j < (dim1 + dim2 + 2); j++) {
-	  agg = tableaus[ntab][i][column] * tableaus[ntab][index][j];
-	  tableaus[ntab][i][j] += agg;
-	}
-	tableaus[ntab][i][column] = 0;
-	
-      }
-      
-    }
+    pivot_tableau(tableaus[ntab],nlines,dim1+dim2+2,index,column,get_column(dim1,dim2,newpivot),pivot);
     
     /*
       Following the complementary pivoting rule, the new variable to pivot on is the complementary of the old variable
@@ -188,16 +436,61 @@ equilibrium* lemke_howson_gen(double*** tableaus, double** bimatrix, int dim1, i
   return eq;
 }
 
+void memo_init(lh_memo* memo, int nlabels) {
+  memo->nlabels = nlabels;
+  memo->artificial = 0;
+  memo->count = 0;
+  memo->skipped = 0;
+  memo->avoided = 0;
+  memo->degenerate = 0;
+}
+
+void memo_free(lh_memo* memo) {
+  free(memo->artificial);
+  memo->artificial = 0;
+}
+
+lh_path* memo_paths(lh_memo* memo, eqlist* node) {
+  lh_path** paths = node ? &node->paths : &memo->artificial;
+  int k;
+
+  if( !*paths ) {
+    *paths = (lh_path*) malloc((memo->nlabels + 1) * sizeof(lh_path));
+    for(k = 0; k <= memo->nlabels; k++)
+      (*paths)[k].end = -1;
+  }
+  return *paths;
+}
+
+void memo_record(lh_memo* memo, eqlist* from, eqlist* to, int label, int steps) {
+  lh_path* p = memo_paths(memo, from);
+  lh_path* q = memo_paths(memo, to);
+
+  p[label].end = to ? to->id : 0;
+  p[label].steps = steps;
+  q[label].end = from ? from->id : 0;
+  q[label].steps = steps;
+}
+
+void memo_print_stats(lh_memo* memo, FILE* f) {
+  fprintf(f,"Path endpoints already known: %d paths and %ld pivoting steps avoided%s\n",memo->skipped,memo->avoided,
+	  memo->degenerate ? " (then turned off: the game is degenerate)" : "");
+}
+
 /*
   This algorithm enumerates alla equilibria reachable by the Lemke-Howson Algorithm. Starting from one known
   equilibrium (the artificial one), the algorithm pivots on all strategies, stores the equilibrium found
   on a list, and if the equilibrium hadn't been found before, calls the algorithm recursively starting from
   that point. The idea for this implementation comes from the All_Lemke function contained in GAMBIT
   game-theory software, for the lcp tool.
+
+  from is the node of the equilibrium we start from, NULL for the artificial equilibrium.
 */
 
-eqlist* all_lemke_gen(double*** tableaus, double** bimatrix, int dim1, int dim2, int taboo, eqlist* lista, int debug) {
-  int pivot, npassi, found;
+static eqlist* all_lemke_rec(double*** tableaus, double** bimatrix, int dim1, int dim2, eqlist* from, int taboo, eqlist* lista, int* steps, lh_memo* memo, int debug) {
+  int pivot, npassi, found, degenerate;
+  eqlist* to;
+  lh_path* paths;
   
   /*
     Each execution of this algorithm has two parameters: the equilibrium to start from, represented by the state 
@@ -208,7 +501,32 @@ eqlist* all_lemke_gen(double*** tableaus, double** bimatrix, int dim1, int dim2,
   for(pivot = 1; pivot <= dim1+dim2; pivot++) {
     if( pivot != taboo ) {
 
-      equilibrium* eq = lemke_howson_gen(tableaus,bimatrix,dim1,dim2,pivot,&npassi,debug);
+      /*
+	If the path leaving this equilibrium with this label was already walked from its other end, we know where
+	it ends, and that equilibrium is already in the list: walking it would only give us back a known
+	equilibrium, after which we would walk it again to come back here.
+      */
+      paths = memo_paths(memo,from);
+      if( !memo->degenerate && paths[pivot].end >= 0 ) {
+	memo->skipped++;
+	memo->avoided += 2L * paths[pivot].steps;
+	continue;
+      }
+
+      equilibrium* eq = lemke_howson_gen(tableaus,bimatrix,dim1,dim2,pivot,&npassi,&degenerate,debug);
+      *steps += npassi;
+
+      /*
+	The path can be walked back only if every pivot on it was forced: after a tie in a ratio test, the
+	walk from the other end can leave the basis by the other row, and reach another equilibrium. Neither
+	can we trust the tableaus restored below to be at the basis we started from, so the first tie turns
+	the memoization off, and the enumeration goes on as without it.
+      */
+      memo->degenerate |= degenerate;
+      if( degenerate == 2 ) {
+	fprintf(stderr,"The Lemke-Howson path with label %d cycles or has no end: the game is degenerate\n",pivot);
+	exit(1);
+      }
       
       /*
 	If we did not reach neither an artificial equilibrium (we don't want to keep the artificial equilibrium in our list
@@ -218,14 +536,21 @@ eqlist* all_lemke_gen(double*** tableaus, double** bimatrix, int dim1, int dim2,
       */
 
       if( !is_artificial(eq) ) {
-	lista = search_add_equilibrium(lista,eq,&found);
+	to = find_add_equilibrium(&lista,eq,&found);
+	if( !found )
+	  to->id = ++memo->count;
+	if( !memo->degenerate )
+	  memo_record(memo,from,to,pivot,npassi);
 	if( !found )
-	  lista = all_lemke_gen(tableaus,bimatrix,dim1,dim2,pivot,lista,debug);
+	  lista = all_lemke_rec(tableaus,bimatrix,dim1,dim2,to,pivot,lista,steps,memo,debug);
 	else
 	  free_equilibrium(eq);
       }
-      else
+      else {
+	if( !memo->degenerate )
+	  memo_record(memo,from,0,pivot,npassi);
 	free_equilibrium(eq);
+      }
       
       /*
 	In our implementation, it's of capital importance to have LH change the tableaus, so we can continue the recursion
@@ -241,10 +566,116 @@ eqlist* all_lemke_gen(double*** tableaus, double** bimatrix, int dim1, int dim2,
 	knowing the variables in basis (because we know the equilibrium we started from). We chose to have a slower implementation
 	rather than creating a whole linear programming library to support this algorithm, or to depend on external LP libraries.
       */
-      lemke_howson_gen(tableaus,bimatrix,dim1,dim2,pivot,&npassi,debug);
+      free_equilibrium(lemke_howson_gen(tableaus,bimatrix,dim1,dim2,pivot,&npassi,0,debug));
+      *steps += npassi;
 
     }
   }
   
   return lista;
 }
+
+eqlist* all_lemke_gen(double*** tableaus, double** bimatrix, int dim1, int dim2, int taboo, eqlist* lista, int* steps, lh_memo* memo, int debug) {
+  lh_memo local;
+
+  if( memo )
+    return all_lemke_rec(tableaus,bimatrix,dim1,dim2,0,taboo,lista,steps,memo,debug);
+
+  memo_init(&local,dim1+dim2);
+  lista = all_lemke_rec(tableaus,bimatrix,dim1,dim2,0,taboo,lista,steps,&local,debug);
+  memo_free(&local);
+  return lista;
+}
+
+/*
+  Symmetric games (B = A transposed). A symmetric equilibrium (x,x) is a complementary solution of the single system
+      r = 1 - A x,  x >= 0,  r >= 0,  x_i * r_i = 0
+  so we can run the complementary pivoting on one tableau only: the tableau of the first player, where the strategies
+  of the second player are identified with those of the first one. Labels go from 1 to dim (strategies) and from -1 to
+  -dim (slack variables), exactly as in the first tableau of create_systems, so get_column(dim,dim,...) still works.
+  This halves both the memory and the pivoting work, and the equilibrium found is symmetric.
+*/
+
+equilibrium* lemke_howson_sym(double** tableau, int dim, int startpivot, int* steps, int debug) {
+  int i, index, newpivot, column;
+  int pivot = startpivot;
+  double tot = 0.0;
+
+  //As in get_pivot_gen, if the strategy is in basis we want its slack variable to enter
+  for( i = 0; i < dim; i++ ) {
+    if( tableau[i][0] == startpivot )
+      pivot = -startpivot;
+  }
+  *steps = 0;
+
+  for (;;) {
+    (*steps)++;
+
+    if( debug & 0x02 ) {
+      fprintf(stdout,"Step no. %d. Symmetric Tableau:\n",*steps);
+      view_tableau_gen(tableau,dim,dim,stdout);
+    }
+
+    column = get_column(dim,dim,pivot);
+    index = min_ratio_row(tableau,dim,column,debug);
+    assert(index >= 0);
+
+    newpivot = (int) tableau[index][0];
+
+    if( debug & 0x01 ) 
+      fprintf(stdout,"Step %d. Label in basis: %d. \t Label out of basis: %d.\t Index of row: %d\n",*steps,pivot,newpivot,index);
+
+    pivot_tableau(tableau,dim,2*dim+2,index,column,get_column(dim,dim,newpivot),pivot);
+
+    pivot = -newpivot;
+
+    if (newpivot == startpivot || newpivot == -startpivot)
+      break;
+  }
+
+  for( i = 0; i < dim; i++ )
+    if( tableau[i][0] > 0 )
+      tot += tableau[i][1];
+
+  //Both players use the same mixed strategy
+  equilibrium* eq = 0;
+  for( i = 0; i < dim; i++ ) {
+    if( tableau[i][0] > 0 ) {
+      eq = add_strategy(eq,(int)tableau[i][0],tableau[i][1]/tot);
+      eq = add_strategy(eq,(int)tableau[i][0]+dim,tableau[i][1]/tot);
+    }
+  }
+
+  return eq;
+}
+
+/*
+  Enumeration of the symmetric equilibria reachable by the symmetric Lemke-Howson algorithm, following all_lemke_gen.
+*/
+
+eqlist* all_lemke_sym(double** tableau, int dim, int taboo, eqlist* lista, int* steps, int debug) {
+  int pivot, npassi, found;
+
+  for(pivot = 1; pivot <= dim; pivot++) {
+    if( pivot != taboo ) {
+
+      equilibrium* eq = lemke_howson_sym(tableau,dim,pivot,&npassi,debug);
+      *steps += npassi;
+
+      if( !is_artificial(eq) ) {
+	lista = search_add_equilibrium(lista,eq,&found);
+	if( !found )
+	  lista = all_lemke_sym(tableau,dim,pivot,lista,steps,debug);
+	else
+	  free_equilibrium(eq);
+      }
+      else
+	free_equilibrium(eq);
+
+      free_equilibrium(lemke_howson_sym(tableau,dim,pivot,&npassi,debug));
+      *steps += npassi;
+    }
+  }
+
+  return lista;
+}
@@ -1,7 +1,77 @@
+#ifndef ALGORITHM_H
+#define ALGORITHM_H
+
 #include "bimatrix.h"
+#include "pool.h"
+#include "ooc.h"
+
+//Pivots on tableaus with at least this number of coefficients, and ratio tests on at least this number of rows, are split among the pivoting threads
+#define PIVOT_PARALLEL_MIN (1 << 18)
+#define RATIO_PARALLEL_MIN 4096
+
+//Replaces the two thresholds above (with the values measured on the host by the tuning, see tune.h). -1 means never
+void set_parallel_thresholds(long pivot_min, long ratio_min);
+long get_pivot_parallel_min(void);
+
+//Relative difference under which two ratios of a minimum ratio test are a tie, for the memoization of the paths (eps is far below the rounding of the ratios)
+#define RATIO_TIE 1e-9
 
 //#define eps 1e-5
 
-equilibrium* lemke_howson_gen(double*** tableaus, double** bimatrix, int dim1, int dim2, int pivot, int *npassi, int debug);
+//Number of threads used by the pivoting kernels (1, the default, for no threads)
+void set_pivot_threads(int threads);
+int get_pivot_threads(void);
+
+//Pivoting kernels, shared by all the engines working on double tableaus
+int min_ratio_row(double** tableau, int nlines, int column, int debug);
+void pivot_tableau(double** tableau, int nlines, int width, int index, int column, int leavecol, int entering);
+
+/*
+  If degenerate is not NULL, it is set to 1 when the path starts at a degenerate basis or a minimum ratio test
+  of the path had a tie, and to 0 otherwise. A degenerate path that comes back to a basis it left is cycling,
+  and one that finds no row in a ratio test has no end: it is abandoned, leaving the tableaus where it got,
+  *degenerate is set to 2 and NULL is returned.
+*/
+equilibrium* lemke_howson_gen(double*** tableaus, double** bimatrix, int dim1, int dim2, int pivot, int *npassi, int* degenerate, int debug);
+
+/*
+  Lemke-Howson paths can be walked both ways: if the path leaving E with label k ends in F, the path leaving
+  F with label k ends in E. The enumeration records the endpoints of the paths it walks in the nodes of the
+  list of equilibria, and skips the paths whose endpoint is already known, with the pivots to walk them and
+  to come back. This holds only for the paths without ties in the ratio tests, leaving a nondegenerate basis:
+  after a tie the walk back can take another row and end elsewhere, and the tableaus restored by walking
+  back can be at another basis than the one of the equilibrium. The first tie shows that the game is
+  degenerate, and from then on no path is recorded or skipped.
+*/
+typedef struct lh_memo_ {
+  int nlabels;
+  lh_path* artificial;  //Paths leaving the artificial equilibrium
+  int count;            //Equilibria numbered so far
+  int skipped;          //Paths not walked because their endpoint was known
+  long avoided;         //Pivots saved on those paths
+  int degenerate;       //A path had a tie: the memoization is off
+} lh_memo;
+
+void memo_init(lh_memo* memo, int nlabels);
+void memo_free(lh_memo* memo);
+
+//Paths leaving the equilibrium of node (the artificial equilibrium if node is NULL), allocated on first use
+lh_path* memo_paths(lh_memo* memo, eqlist* node);
+
+//Records the path with the given label between the equilibria of from and to (NULL for the artificial one), both ways
+void memo_record(lh_memo* memo, eqlist* from, eqlist* to, int label, int steps);
+
+//Prints how many paths and pivots the memoization avoided
+void memo_print_stats(lh_memo* memo, FILE* f);
+
+/*
+  Enumerates all equilibria reachable by LH from the artificial one. The number of pivoting steps performed
+  is added to *steps. memo can be NULL; otherwise it must be initialized, and it keeps the statistics.
+*/
+eqlist* all_lemke_gen(double*** tableaus, double** bimatrix, int dim1, int dim2, int taboo, eqlist* , int* steps, lh_memo* memo, int debug);
+
+//Lemke-Howson on the single tableau of a symmetric game: the equilibria found are symmetric
+equilibrium* lemke_howson_sym(double** tableau, int dim, int startpivot, int* steps, int debug);
+eqlist* all_lemke_sym(double** tableau, int dim, int taboo, eqlist* lista, int* steps, int debug);
 
-eqlist* all_lemke_gen(double*** tableaus, double** bimatrix, int dim1, int dim2, int taboo, eqlist* , int debug);
+#endif
@@ -0,0 +1,454 @@
+/*
+  Approximate equilibria with predictive regret matching+.
+
+  Each player keeps, for every pure strategy, its cumulated regret clipped at 0 (q). At each iteration
+  the player computes the payoffs u of its pure strategies against the current strategy of the opponent,
+  and their instantaneous regrets r = u - (value of its current strategy); then q = max(0, q + r), and
+  the new strategy is proportional to max(0, q + r), that is the regrets predicted for the next iteration
+  assuming that r repeats. The first player moves first, and the second one answers to the new strategy.
+
+  The products A y and x B are the whole cost. A y is a dot product per row, computed in blocks of
+  APPROX_BLOCK rows, so that each vector of y is loaded once for all of them. x B is a sum of the rows of
+  B weighted by x, taken only on the support of x, which in these dynamics is often small. Both are
+  written with GCC vector extensions and compiled for AVX-512, AVX2 and the baseline as the batch is.
+  With threads, A y is split by rows and x B by columns, so that no two threads write the same payoff.
+
+  The payoffs the two players compute for their update also give, for free, the regrets of the profile
+  made of the new strategy of the first player and of the old one of the second: that profile and the
+  linear averages (checked every APPROX_CHECK iterations) are the candidates for the result.
+*/
+
+#include <string.h>
+#include <unistd.h>
+
+#include "approx.h"
+
+typedef double approx_vec __attribute__((vector_size(APPROX_VEC * sizeof(double))));
+
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define APPROX_TARGETS __attribute__((target_clones("avx512f","avx2","default")))
+#else
+#define APPROX_TARGETS
+#endif
+
+typedef struct product_job_ {
+  double** m;        //Rows of the matrix
+  int nrows, ncols;
+  const double* v;
+  const int* support; //Rows with a nonzero weight in v, for the products by columns
+  int nsupport;
+  double* out;
+} product_job;
+
+//out[i] = m[i] . v for the rows from first to last (excluded)
+APPROX_TARGETS
+static void rows_kernel(double** m, int first, int last, int ncols, const double* v, double* out) {
+  approx_vec s[APPROX_BLOCK], a, w;
+  double tail[APPROX_BLOCK];
+  int i, j, b, k;
+
+  for(i = first; i < last; i += APPROX_BLOCK) {
+    int n = last - i < APPROX_BLOCK ? last - i : APPROX_BLOCK;
+
+    for(b = 0; b < APPROX_BLOCK; b++) {
+      s[b] = (approx_vec) { 0.0 };
+      tail[b] = 0.0;
+    }
+
+    if( n == APPROX_BLOCK ) {
+      for(j = 0; j + APPROX_VEC <= ncols; j += APPROX_VEC) {
+	memcpy(&w, v + j, sizeof(w));
+	for(b = 0; b < APPROX_BLOCK; b++) {
+	  memcpy(&a, m[i + b] + j, sizeof(a));
+	  s[b] += a * w;
+	}
+      }
+    }
+    else
+      j = 0;
+
+    for(b = 0; b < n; b++) {
+      for(k = j; k < ncols; k++)
+	tail[b] += m[i + b][k] * v[k];
+      for(k = 0; k < APPROX_VEC; k++)
+	tail[b] += s[b][k];
+      out[i + b] = tail[b];
+    }
+  }
+}
+
+//out[j] = sum of w[k] m[rows[k]][j] for the columns from first to last (excluded)
+APPROX_TARGETS
+static void columns_kernel(double** m, const int* rows, const double* w, int nrows, int first, int last, double* out) {
+  approx_vec o, a0, a1, a2, a3;
+  double *m0, *m1, *m2, *m3, w0, w1, w2, w3;
+  int j, k;
+
+  for(j = first; j < last; j++)
+    out[j] = 0.0;
+
+  for(k = 0; k + APPROX_BLOCK <= nrows; k += APPROX_BLOCK) {
+    m0 = m[rows[k]]; m1 = m[rows[k + 1]]; m2 = m[rows[k + 2]]; m3 = m[rows[k + 3]];
+    w0 = w[rows[k]]; w1 = w[rows[k + 1]]; w2 = w[rows[k + 2]]; w3 = w[rows[k + 3]];
+    for(j = first; j + APPROX_VEC <= last; j += APPROX_VEC) {
+      memcpy(&o, out + j, sizeof(o));
+      memcpy(&a0, m0 + j, sizeof(a0));
+      memcpy(&a1, m1 + j, sizeof(a1));
+      memcpy(&a2, m2 + j, sizeof(a2));
+      memcpy(&a3, m3 + j, sizeof(a3));
+      o += w0 * a0 + w1 * a1 + w2 * a2 + w3 * a3;
+      memcpy(out + j, &o, sizeof(o));
+    }
+    for( ; j < last; j++)
+      out[j] += w0 * m0[j] + w1 * m1[j] + w2 * m2[j] + w3 * m3[j];
+  }
+
+  for( ; k < nrows; k++) {
+    m0 = m[rows[k]];
+    w0 = w[rows[k]];
+    for(j = first; j < last; j++)
+      out[j] += w0 * m0[j];
+  }
+}
+
+static void rows_worker(void* arg, int t, int nthreads) {
+  product_job* job = (product_job*) arg;
+  int first = (int) ((long) job->nrows * t / nthreads);
+  int last = (int) ((long) job->nrows * (t + 1) / nthreads);
+
+  //Blocks of rows are not split between threads
+  first -= first % APPROX_BLOCK;
+  last = t == nthreads - 1 ? job->nrows : last - last % APPROX_BLOCK;
+  rows_kernel(job->m,first,last,job->ncols,job->v,job->out);
+}
+
+static void columns_worker(void* arg, int t, int nthreads) {
+  product_job* job = (product_job*) arg;
+  int chunks = (job->ncols + APPROX_VEC - 1) / APPROX_VEC;
+  int first = (int) ((long) chunks * t / nthreads) * APPROX_VEC;
+  int last = (int) ((long) chunks * (t + 1) / nthreads) * APPROX_VEC;
+
+  last = last > job->ncols ? job->ncols : last;
+  if( first < last )
+    columns_kernel(job->m,job->support,job->v,job->nsupport,first,last,job->out);
+}
+
+//out = m v, m having nrows rows of ncols payoffs
+static void rows_product(thread_pool* pool, double** m, int nrows, int ncols, const double* v, double* out) {
+  product_job job;
+
+  if( !pool ) {
+    rows_kernel(m,0,nrows,ncols,v,out);
+    return;
+  }
+  job.m = m;
+  job.nrows = nrows;
+  job.ncols = ncols;
+  job.v = v;
+  job.out = out;
+  pool_run(pool,rows_worker,&job);
+}
+
+//out = v m, support being the indices of the nonzero elements of v
+static void columns_product(thread_pool* pool, double** m, int nrows, int ncols, const double* v, int* support, double* out) {
+  product_job job;
+  int i, n = 0;
+
+  for(i = 0; i < nrows; i++) {
+    if( v[i] != 0.0 )
+      support[n++] = i;
+  }
+
+  if( !pool ) {
+    columns_kernel(m,support,v,n,0,ncols,out);
+    return;
+  }
+  job.m = m;
+  job.nrows = nrows;
+  job.ncols = ncols;
+  job.v = v;
+  job.support = support;
+  job.nsupport = n;
+  job.out = out;
+  pool_run(pool,columns_worker,&job);
+}
+
+//Regret of the strategy s against the payoffs u of the pure strategies
+static double regret(const double* s, const double* u, int n) {
+  double best = u[0], value = 0.0;
+  int i;
+
+  for(i = 0; i < n; i++) {
+    best = u[i] > best ? u[i] : best;
+    value += s[i] * u[i];
+  }
+  return best - value > 0.0 ? best - value : 0.0;
+}
+
+/*
+  Update of one player, given the payoffs u of its pure strategies against the opponent: q are the
+  clipped cumulated regrets, s the strategy, replaced by the new one. Without positive regrets the
+  new strategy is uniform.
+*/
+
+static void regret_matching(double* q, double* s, const double* u, int n) {
+  double value = 0.0, sum = 0.0, r;
+  int i;
+
+  for(i = 0; i < n; i++)
+    value += s[i] * u[i];
+
+  for(i = 0; i < n; i++) {
+    r = u[i] - value;
+    q[i] = q[i] + r > 0.0 ? q[i] + r : 0.0;
+    s[i] = q[i] + r > 0.0 ? q[i] + r : 0.0;
+    sum += s[i];
+  }
+
+  for(i = 0; i < n; i++)
+    s[i] = sum > 0.0 ? s[i] / sum : 1.0 / n;
+}
+
+//Builds the equilibrium from the two dense strategies, inserting the labels from the last one so that each insertion is at the head
+static equilibrium* sparse_strategies(const double* x, const double* y, int dim1, int dim2) {
+  equilibrium* eq = 0;
+  int i;
+
+  for(i = dim2 - 1; i >= 0; i--) {
+    if( y[i] > 0.0 )
+      eq = add_strategy(eq,dim1 + i + 1,y[i]);
+  }
+  for(i = dim1 - 1; i >= 0; i--) {
+    if( x[i] > 0.0 )
+      eq = add_strategy(eq,i + 1,x[i]);
+  }
+  return eq;
+}
+
+static double relative_regret(double** bimatrix, int dim1, int dim2, equilibrium* eq, int* valid) {
+  eq_check check;
+
+  check_equilibrium(bimatrix,dim1,dim2,eq,&check);
+  *valid = check.mass_error <= VERIFY_TOL;
+  return (check.regret1 > check.regret2 ? check.regret1 : check.regret2) / check.scale;
+}
+
+typedef struct ranked_ {
+  double payoff;
+  int index;
+} ranked;
+
+static int by_payoff(const void* a, const void* b) {
+  const ranked* ra = (const ranked*) a;
+  const ranked* rb = (const ranked*) b;
+
+  if( ra->payoff != rb->payoff )
+    return ra->payoff < rb->payoff ? 1 : -1;
+  return ra->index - rb->index;
+}
+
+//Number of strategies of s with probability above cut times the largest one
+static int support_above(const double* s, int n, double cut) {
+  double max = 0.0;
+  int i, k = 0;
+
+  for(i = 0; i < n; i++)
+    max = s[i] > max ? s[i] : max;
+  for(i = 0; i < n; i++)
+    k += s[i] > cut * max;
+  return k;
+}
+
+//Strategies of a player sorted by their payoff u against the opponent, the best responses first
+static void rank_responses(const double* u, int n, ranked* out) {
+  int i;
+
+  for(i = 0; i < n; i++) {
+    out[i].payoff = u[i];
+    out[i].index = i;
+  }
+  qsort(out,n,sizeof(ranked),by_payoff);
+}
+
+//Equilibrium on the first k strategies of r1 and r2, with the probabilities of x and y scaled to sum to 1 (uniform if they are all 0)
+static equilibrium* support_profile(const ranked* r1, const ranked* r2, int k, const double* x, const double* y, int dim1) {
+  equilibrium* eq = 0;
+  double sum1 = 0.0, sum2 = 0.0;
+  int i;
+
+  for(i = 0; i < k; i++) {
+    sum1 += x[r1[i].index];
+    sum2 += y[r2[i].index];
+  }
+  for(i = 0; i < k; i++) {
+    eq = add_strategy(eq,r1[i].index + 1,sum1 > 0.0 ? x[r1[i].index] / sum1 : 1.0 / k);
+    eq = add_strategy(eq,dim1 + r2[i].index + 1,sum2 > 0.0 ? y[r2[i].index] / sum2 : 1.0 / k);
+  }
+  return eq;
+}
+
+/*
+  Polishing. In a nondegenerate game the two supports of an equilibrium have the same size k, and
+  they are made of best responses: the equilibrium is the solution of the indifference equations on
+  the k best responses of each player. Near an equilibrium the best responses to the approximate
+  profile are those of the equilibrium, in the same order, but its supports can be larger (strategies
+  with a vanishing probability) or smaller (pure strategies still rising) than the exact ones. So we
+  try as k the support sizes of both players at each cut of APPROX_SUPPORT_CUTS, let refine_equilibrium
+  solve the equations, and keep the best candidate if it has a lower regret than the approximate
+  profile. Returns the size of its supports, or 0.
+*/
+
+static int polish(double** bimatrix, int dim1, int dim2, const double* x, const double* y, equilibrium** eq, double* best) {
+  double cuts[] = APPROX_SUPPORT_CUTS;
+  int ncuts = sizeof(cuts) / sizeof(cuts[0]);
+  double* u1 = (double*) malloc(dim1 * sizeof(double));
+  double* u2 = (double*) malloc(dim2 * sizeof(double));
+  int* support = (int*) malloc(dim1 * sizeof(int));
+  ranked* r1 = (ranked*) malloc(dim1 * sizeof(ranked));
+  ranked* r2 = (ranked*) malloc(dim2 * sizeof(ranked));
+  char* tried = (char*) calloc((dim1 < dim2 ? dim1 : dim2) + 1, sizeof(char));
+  equilibrium* candidate;
+  double e;
+  int c, p, k, valid, polished = 0;
+
+  rows_product(0,bimatrix,dim1,dim2,y,u1);
+  columns_product(0,bimatrix + dim1,dim1,dim2,x,support,u2);
+  rank_responses(u1,dim1,r1);
+  rank_responses(u2,dim2,r2);
+
+  for(c = 0; c < 2 * ncuts + APPROX_POLISH_SMALL; c++) {
+    p = c % 2;
+    if( c < 2 * ncuts )
+      k = p == 0 ? support_above(x,dim1,cuts[c / 2]) : support_above(y,dim2,cuts[c / 2]);
+    else
+      k = c - 2 * ncuts + 1;
+    if( k > dim1 || k > dim2 || k > APPROX_POLISH_MAX || tried[k] )
+      continue;
+    tried[k] = 1;
+
+    candidate = support_profile(r1,r2,k,x,y,dim1);
+    refine_equilibrium(bimatrix,dim1,dim2,candidate);
+    e = relative_regret(bimatrix,dim1,dim2,candidate,&valid);
+    if( valid && e < *best ) {
+      free_equilibrium(*eq);
+      *eq = candidate;
+      *best = e;
+      polished = k;
+    }
+    else
+      free_equilibrium(candidate);
+  }
+
+  free(u1); free(u2); free(support); free(r1); free(r2); free(tried);
+  return polished;
+}
+
+void approx_default_options(approx_options* opt) {
+  opt->target = APPROX_EPS;
+  opt->iterations = APPROX_MAX_ITERATIONS;
+  opt->threads = 0;
+  opt->polish = 0;
+}
+
+equilibrium* approx_equilibrium(double** bimatrix, int dim1, int dim2, approx_options* opt, approx_result* res) {
+  double** a = bimatrix;
+  double** b = bimatrix + dim1;
+  double* x = (double*) malloc(dim1 * sizeof(double));
+  double* y = (double*) malloc(dim2 * sizeof(double));
+  double* q1 = (double*) calloc(dim1, sizeof(double));
+  double* q2 = (double*) calloc(dim2, sizeof(double));
+  double* u1 = (double*) malloc(dim1 * sizeof(double));
+  double* u2 = (double*) malloc(dim2 * sizeof(double));
+  double* sx = (double*) calloc(dim1, sizeof(double));
+  double* sy = (double*) calloc(dim2, sizeof(double));
+  double* ax = (double*) malloc(dim1 * sizeof(double));
+  double* ay = (double*) malloc(dim2 * sizeof(double));
+  double* bx = (double*) malloc(dim1 * sizeof(double));
+  double* by = (double*) malloc(dim2 * sizeof(double));
+  int* support = (int*) malloc(dim1 * sizeof(int));
+  double max = bimatrix[0][0], min = bimatrix[0][0], scale, best = HUGE_VAL, e, weight = 0.0;
+  thread_pool* pool = 0;
+  equilibrium* eq;
+  int i, j, t, threads = opt->threads, valid;
+
+  if( threads <= 0 )
+    threads = (long) dim1 * dim2 >= APPROX_PARALLEL_MIN ? (int) sysconf(_SC_NPROCESSORS_ONLN) : 1;
+  if( threads > 1 )
+    pool = pool_create(threads);
+
+  for(i = 0; i < (2 * dim1); i++) {
+    for(j = 0; j < dim2; j++) {
+      max = bimatrix[i][j] > max ? bimatrix[i][j] : max;
+      min = bimatrix[i][j] < min ? bimatrix[i][j] : min;
+    }
+  }
+  scale = max - min > 0.0 ? max - min : 1.0;
+
+  for(i = 0; i < dim1; i++)
+    x[i] = 1.0 / dim1;
+  for(j = 0; j < dim2; j++)
+    y[j] = 1.0 / dim2;
+
+  for(t = 1; t <= opt->iterations && best > opt->target; t++) {
+    rows_product(pool,a,dim1,dim2,y,u1);
+    regret_matching(q1,x,u1,dim1);
+    columns_product(pool,b,dim1,dim2,x,support,u2);
+
+    //The new x against the old y, before the second player moves
+    e = (regret(x,u1,dim1) > regret(y,u2,dim2) ? regret(x,u1,dim1) : regret(y,u2,dim2)) / scale;
+    if( e < best ) {
+      best = e;
+      memcpy(bx,x,dim1 * sizeof(double));
+      memcpy(by,y,dim2 * sizeof(double));
+    }
+
+    regret_matching(q2,y,u2,dim2);
+
+    weight += t;
+    for(i = 0; i < dim1; i++)
+      sx[i] += t * x[i];
+    for(j = 0; j < dim2; j++)
+      sy[j] += t * y[j];
+
+    if( t % APPROX_CHECK == 0 ) {
+      for(i = 0; i < dim1; i++)
+	ax[i] = sx[i] / weight;
+      for(j = 0; j < dim2; j++)
+	ay[j] = sy[j] / weight;
+      rows_product(pool,a,dim1,dim2,ay,u1);
+      columns_product(pool,b,dim1,dim2,ax,support,u2);
+      e = (regret(ax,u1,dim1) > regret(ay,u2,dim2) ? regret(ax,u1,dim1) : regret(ay,u2,dim2)) / scale;
+      if( e < best ) {
+	best = e;
+	memcpy(bx,ax,dim1 * sizeof(double));
+	memcpy(by,ay,dim2 * sizeof(double));
+      }
+    }
+  }
+
+  res->iterations = t - 1;
+  eq = sparse_strategies(bx,by,dim1,dim2);
+
+  //Measured again as -v does, on the probabilities that are returned
+  res->dynamics_regret = relative_regret(bimatrix,dim1,dim2,eq,&valid);
+  res->regret = res->dynamics_regret;
+  res->polished = opt->polish ? polish(bimatrix,dim1,dim2,bx,by,&eq,&res->regret) : 0;
+
+  if( pool )
+    pool_free(pool);
+  free(x); free(y); free(q1); free(q2); free(u1); free(u2);
+  free(sx); free(sy); free(ax); free(ay); free(bx); free(by);
+  free(support);
+  return eq;
+}
+
+void approx_print_result(approx_options* opt, approx_result* res, FILE* f) {
+  fprintf(f,"Regret dynamics: relative regret %.3e after %d iterations (target %.3e)%s\n",res->dynamics_regret,res->iterations,opt->target,
+	  res->dynamics_regret <= opt->target ? "" : ": target not reached");
+  if( opt->polish ) {
+    if( res->polished )
+      fprintf(f,"Polished on supports of %d strategies: relative regret %.3e\n",res->polished,res->regret);
+    else
+      fprintf(f,"Polishing did not improve the profile\n");
+  }
+}
@@ -0,0 +1,67 @@
+#ifndef APPROX_H
+#define APPROX_H
+
+#include "verify.h"
+#include "pool.h"
+
+/*
+  Approximate engine, for games whose tableaus would not fit in memory or whose Lemke-Howson paths
+  would be too long. It works on the bimatrix only, with no-regret dynamics: predictive regret
+  matching+, where the two players update their strategies in turn. Each iteration costs two
+  matrix-vector products, A y and x B, which are split among threads by blocks of rows (or of
+  columns) and computed with vector instructions.
+
+  In constant-sum games the average strategies converge to an equilibrium. In general games nothing
+  is guaranteed: we keep the best profile seen, among the current strategies and their averages,
+  and stop when its regret is below the target, or after the maximum number of iterations.
+
+  Epsilon is the largest regret of the two players, relative to the range of the payoffs (the
+  difference between the largest and the smallest payoff of the game).
+*/
+
+//Default target and maximum number of iterations
+#define APPROX_EPS 1e-3
+#define APPROX_MAX_ITERATIONS 10000
+
+//The average strategies are checked every APPROX_CHECK iterations, which costs two more products
+#define APPROX_CHECK 16
+
+//Games with at least this number of payoffs in each matrix use one thread per processor by default
+#define APPROX_PARALLEL_MIN (1 << 18)
+
+//Doubles in each vector of the products (an AVX-512 register), and rows of the bimatrix read together
+#define APPROX_VEC 8
+#define APPROX_BLOCK 4
+
+/*
+  Polishing: the support sizes tried are the number of strategies of each player with a probability above
+  one of these fractions of the largest one, and all the sizes up to APPROX_POLISH_SMALL.
+*/
+#define APPROX_SUPPORT_CUTS { 1e-4, 1e-3, 1e-2, 1e-1 }
+#define APPROX_POLISH_SMALL 8
+
+//Largest support polished: the equations are solved in long double, with a cubic cost
+#define APPROX_POLISH_MAX 512
+
+typedef struct approx_options_ {
+  double target;     //Target relative regret
+  int iterations;    //Maximum number of iterations
+  int threads;       //Threads for the products (0 for automatic)
+  int polish;        //Tries to turn the result in an exact equilibrium
+} approx_options;
+
+typedef struct approx_result_ {
+  int iterations;
+  double regret;          //Relative regret of the profile returned
+  double dynamics_regret; //Relative regret of the best profile of the dynamics
+  int polished;           //Size of the support of each player if the profile comes from the polishing, 0 otherwise
+} approx_result;
+
+void approx_default_options(approx_options* opt);
+
+//Returns the best profile found, in the same representation of the equilibria of the other engines
+equilibrium* approx_equilibrium(double** bimatrix, int dim1, int dim2, approx_options* opt, approx_result* res);
+
+void approx_print_result(approx_options* opt, approx_result* res, FILE* f);
+
+#endif
@@ -0,0 +1,241 @@
+#include "batch.h"
+
+#define L LH_BATCH_LANES
+
+/*
+  One coefficient of the tableaus, for all the lanes. With GCC vector extensions the operations on
+  lane_vec are compiled to the widest vector instructions available, and on x86-64 the batch is
+  compiled for AVX-512, AVX2 and the baseline, the best version for the processor being chosen at
+  load time: with vectors of 2 doubles only, the lanes gain little over solving the games one at a time.
+*/
+
+typedef double lane_vec __attribute__((vector_size(L * sizeof(double))));
+typedef long long lane_mask __attribute__((vector_size(L * sizeof(long long))));
+
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define BATCH_TARGETS __attribute__((target_clones("avx512f","avx2","default")))
+#else
+#define BATCH_TARGETS
+#endif
+
+typedef struct batch_state_ {
+  int dim1, dim2, width;
+  int nlines[2];
+  lane_vec* tab[2]; //Coefficient j of row i of tableau t is tab[t][i * width + j], lane l being its element l
+  int* basis[2];    //Label in basis of row i of tableau t, lane l: basis[t][i * L + l]
+  lane_vec* prow;   //Normalized pivot rows of the lanes
+
+  int game[L];      //Game loaded in each lane, -1 if the lane is empty
+  int pivot[L];
+  int steps[L];
+} batch_state;
+
+#define COEF(s,t,i,j,l) (s)->tab[t][(long) (i) * (s)->width + (j)][l]
+
+//Lane by lane a where the mask is set, b elsewhere
+#define SELECT(m,a,b) ((lane_vec) (((lane_mask) (a) & (m)) | ((lane_mask) (b) & ~(m))))
+
+/*
+  Loads a game in a lane, building the same tableaus create_systems builds from the positivized bimatrix.
+*/
+
+static void load_lane(batch_state* s, int l, double** bimatrix, double min) {
+  int i, j;
+
+  positivize_bimatrix(bimatrix,s->dim1,s->dim2,min);
+
+  for(i = 0; i < s->dim1; i++) {
+    s->basis[0][i * L + l] = - i - 1;
+    for(j = 1; j < s->width; j++)
+      COEF(s,0,i,j,l) = 0.0;
+    COEF(s,0,i,1,l) = 1.0;
+    for(j = 0; j < s->dim2; j++)
+      COEF(s,0,i,2 + s->dim1 + j,l) = - bimatrix[i][j];
+  }
+  for(i = 0; i < s->dim2; i++) {
+    s->basis[1][i * L + l] = - i - s->dim1 - 1;
+    for(j = 1; j < s->width; j++)
+      COEF(s,1,i,j,l) = 0.0;
+    COEF(s,1,i,1,l) = 1.0;
+    for(j = 0; j < s->dim1; j++)
+      COEF(s,1,i,2 + s->dim2 + j,l) = - bimatrix[s->dim1 + j][i];
+  }
+}
+
+//The equilibrium of a lane, normalized as in lemke_howson_gen
+static equilibrium* lane_equilibrium(batch_state* s, int l) {
+  equilibrium* eq = 0;
+  double tot[2] = { 0.0, 0.0 };
+  int t, i;
+
+  for(t = 0; t < 2; t++)
+    for(i = 0; i < s->nlines[t]; i++)
+      if( s->basis[t][i * L + l] > 0 )
+	tot[t] += COEF(s,t,i,1,l);
+
+  for(t = 0; t < 2; t++)
+    for(i = 0; i < s->nlines[t]; i++)
+      if( s->basis[t][i * L + l] > 0 )
+	eq = add_strategy(eq,s->basis[t][i * L + l],COEF(s,t,i,1,l)/tot[t]);
+
+  return eq;
+}
+
+//Puts the next game of the queue in lane l, or empties it
+static void refill_lane(batch_state* s, int l, batch_source source, void* ctx, int* next, int count, int startpivot) {
+  double** bimatrix;
+  double min;
+
+  s->game[l] = -1;
+  if( *next >= count )
+    return;
+
+  bimatrix = source(ctx,*next,&min);
+  load_lane(s,l,bimatrix,min);
+  free_bimatrix(bimatrix,s->dim1,s->dim2);
+  s->game[l] = (*next)++;
+  s->pivot[l] = startpivot;
+  s->steps[l] = 0;
+}
+
+BATCH_TARGETS
+void batch_lemke_howson(batch_source source, void* ctx, int count, int dim1, int dim2, int startpivot, equilibrium** results, int* steps) {
+  batch_state st, *s = &st;
+  int column[L], index[L], newpivot[L], active[L];
+  lane_vec mask, coeff, x, val, min, factor;
+  lane_mask qualify, better, best;
+  const lane_vec zero = { 0.0 };
+  int next = 0, running, nonzero, t, i, j, l;
+  void* mem;
+
+  s->dim1 = dim1;
+  s->dim2 = dim2;
+  s->width = 2 + dim1 + dim2;
+  s->nlines[0] = dim1;
+  s->nlines[1] = dim2;
+  for(t = 0; t < 2; t++) {
+    if( posix_memalign(&mem, sizeof(lane_vec), (long) s->nlines[t] * s->width * sizeof(lane_vec)) ) {
+      fprintf(stderr,"Out of memory\n");
+      exit(1);
+    }
+    s->tab[t] = (lane_vec*) mem;
+    s->basis[t] = (int*) calloc(s->nlines[t] * L, sizeof(int));
+  }
+  if( posix_memalign(&mem, sizeof(lane_vec), s->width * sizeof(lane_vec)) ) {
+    fprintf(stderr,"Out of memory\n");
+    exit(1);
+  }
+  s->prow = (lane_vec*) mem;
+
+  for(l = 0; l < L; l++)
+    refill_lane(s,l,source,ctx,&next,count,startpivot);
+
+  /*
+    A pivot in one tableau makes the complement of the leaving label enter the other one, so the
+    Lemke-Howson algorithm alternates between the two tableaus. All the lanes pivot in the same tableau
+    t at each step: a game just loaded whose first pivot is in the other tableau waits for one step.
+  */
+  t = get_tableau(dim1,dim2,startpivot);
+
+  for(;; t = 1 - t) {
+    running = 0;
+    for(l = 0; l < L; l++) {
+      running += s->game[l] >= 0;
+      active[l] = s->game[l] >= 0 && get_tableau(dim1,dim2,s->pivot[l]) == t;
+      column[l] = active[l] ? get_column(dim1,dim2,s->pivot[l]) : 1;
+      mask[l] = active[l] ? 1.0 : 0.0;
+    }
+    if( !running )
+      break;
+
+    lane_vec* tab = s->tab[t];
+    const int nlines = s->nlines[t];
+    const int width = s->width;
+
+    /*
+      Minimum ratio test of min_ratio_row, on all the lanes at once, each one on the column of its
+      entering variable: only the coefficients of that column are gathered lane by lane.
+    */
+    min = zero;
+    best = (lane_mask) zero - 1;
+    for(i = 0; i < nlines; i++) {
+      for(l = 0; l < L; l++)
+	x[l] = tab[i * width + column[l]][l];
+      x *= mask;
+      qualify = x < -eps;
+      val = -tab[i * width + 1] / SELECT(qualify, x, zero - 1.0);
+      better = qualify & ((best < 0) | (val < (min - eps)));
+      min = SELECT(better, val, min);
+      best = (best & ~better) | (i & better);
+    }
+
+    /*
+      The pivot rows are normalized as in pivot_tableau, and copied in prow: the lanes that are not
+      pivoting get a zero row, so the elimination below leaves them unchanged. The bookkeeping on the
+      labels is done lane by lane, the division on all the lanes at once.
+    */
+    for(l = 0; l < L; l++) {
+      index[l] = active[l] ? (int) best[l] : 0;
+      coeff[l] = 1.0;
+      if( !active[l] )
+	continue;
+      assert(index[l] >= 0);
+      newpivot[l] = s->basis[t][index[l] * L + l];
+      tab[index[l] * width + get_column(dim1,dim2,newpivot[l])][l] = -1;
+      s->basis[t][index[l] * L + l] = s->pivot[l];
+      coeff[l] = -tab[index[l] * width + column[l]][l];
+    }
+    for(j = 1; j < width; j++) {
+      for(l = 0; l < L; l++)
+	x[l] = tab[index[l] * width + j][l];
+      s->prow[j] = (x / coeff) * mask;
+    }
+    for(l = 0; l < L; l++) {
+      s->prow[column[l]][l] = 0.0;
+      if( active[l] )
+	for(j = 1; j < width; j++)
+	  tab[index[l] * width + j][l] = s->prow[j][l];
+    }
+
+    /*
+      Elimination: every operation works on all the lanes, with a factor that is zero for the lanes
+      that must not change this row.
+    */
+    for(i = 0; i < nlines; i++) {
+      lane_vec* row = tab + i * width;
+      for(l = 0; l < L; l++)
+	x[l] = row[column[l]][l];
+      x *= mask;
+      factor = SELECT((x < -eps) | (x > eps), x, zero);
+      for(l = 0, nonzero = 0; l < L; l++)
+	nonzero |= factor[l] != 0.0;
+      if( !nonzero )
+	continue;
+      for(j = 1; j < width; j++)
+	row[j] += factor * s->prow[j];
+      for(l = 0; l < L; l++)
+	if( factor[l] != 0.0 )
+	  row[column[l]][l] = 0.0;
+    }
+
+    //Complementary pivoting rule, termination and refilling of the lanes
+    for(l = 0; l < L; l++) {
+      if( !active[l] )
+	continue;
+      s->steps[l]++;
+      s->pivot[l] = -newpivot[l];
+      if( newpivot[l] != startpivot && newpivot[l] != -startpivot )
+	continue;
+
+      results[s->game[l]] = lane_equilibrium(s,l);
+      steps[s->game[l]] = s->steps[l];
+      refill_lane(s,l,source,ctx,&next,count,startpivot);
+    }
+  }
+
+  for(t = 0; t < 2; t++) {
+    free(s->tab[t]);
+    free(s->basis[t]);
+  }
+  free(s->prow);
+}
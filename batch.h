@@ -0,0 +1,29 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "algorithm.h"
+
+/*
+  Batched Lemke-Howson for many small games of the same size. LH_BATCH_LANES games are pivoted in
+  lockstep: every coefficient of the tableaus is stored as a vector of LH_BATCH_LANES doubles, one per
+  game (structure of arrays), so the row updates of all the games are done by the same vector
+  instructions even if the rows of a single game are only a few doubles wide. When a game reaches its
+  equilibrium, its lane is loaded with the next game of the queue.
+*/
+
+#define LH_BATCH_LANES 8
+
+/*
+  Called to get game number k of the queue: it returns the bimatrix (which the batch frees after loading
+  it) and sets the minimum payoff, as get_random_bimatrix_gen does.
+*/
+typedef double** (*batch_source)(void* ctx, int k, double* min);
+
+/*
+  Solves the games 0..count-1 of the source with the Lemke-Howson algorithm from startpivot. The
+  equilibria and the number of pivoting steps of game k are put in results[k] and steps[k]: they are the
+  same that lemke_howson_gen finds.
+*/
+void batch_lemke_howson(batch_source source, void* ctx, int count, int dim1, int dim2, int startpivot, equilibrium** results, int* steps);
+
+#endif
@@ -0,0 +1,468 @@
+/*
+  Bignum library.
+
+  A small arbitrary precision integer implementation, just what the exact pivoting engine needs:
+  sum, difference, product and division (Knuth's algorithm D, as presented in Hacker's Delight).
+  It's not meant to compete with GMP: the exact engine works with 64 bit integers as long as it
+  can, and promotes a row to bignums only when that row overflows.
+*/
+
+#include <string.h>
+#include "bignum.h"
+
+static void bn_reserve(bignum* a, int n) {
+  if( a->alloc >= n )
+    return;
+
+  a->limb = (unsigned int*) realloc(a->limb, n * sizeof(unsigned int));
+  a->alloc = n;
+}
+
+//Removes the leading zero limbs, and fixes the sign of zero
+
+static void bn_normalize(bignum* a) {
+  while( a->size > 0 && a->limb[a->size - 1] == 0 )
+    a->size--;
+  if( a->size == 0 )
+    a->sign = 0;
+}
+
+void bn_init(bignum* a) {
+  a->sign = 0;
+  a->size = 0;
+  a->alloc = 0;
+  a->limb = 0;
+}
+
+void bn_free(bignum* a) {
+  free(a->limb);
+  bn_init(a);
+}
+
+void bn_set_i128(bignum* a, __int128 v) {
+  unsigned __int128 m;
+
+  a->sign = v < 0 ? -1 : (v > 0 ? 1 : 0);
+  m = v < 0 ? -(unsigned __int128) v : (unsigned __int128) v;
+
+  bn_reserve(a, 4);
+  a->size = 0;
+  while( m != 0 ) {
+    a->limb[a->size++] = (unsigned int) m;
+    m >>= 32;
+  }
+}
+
+void bn_set_ll(bignum* a, long long v) {
+  bn_set_i128(a, (__int128) v);
+}
+
+int bn_get_ll(const bignum* a, long long* v) {
+  unsigned long long m = 0;
+  int i;
+
+  if( a->size > 2 )
+    return 0;
+  for( i = a->size - 1; i >= 0; i-- )
+    m = (m << 32) | a->limb[i];
+
+  if( a->sign >= 0 ) {
+    if( m > 0x7FFFFFFFFFFFFFFFULL )
+      return 0;
+    *v = (long long) m;
+  }
+  else {
+    if( m > 0x8000000000000000ULL )
+      return 0;
+    *v = (long long) (0 - m);
+  }
+  return 1;
+}
+
+void bn_copy(bignum* r, const bignum* a) {
+  if( r == a )
+    return;
+
+  bn_reserve(r, a->size);
+  if( a->size > 0 )
+    memcpy(r->limb, a->limb, a->size * sizeof(unsigned int));
+  r->size = a->size;
+  r->sign = a->sign;
+}
+
+double bn_to_double(const bignum* a) {
+  double d = 0.0;
+  int i;
+
+  for( i = a->size - 1; i >= 0; i-- )
+    d = d * 4294967296.0 + a->limb[i];
+
+  return a->sign < 0 ? -d : d;
+}
+
+int bn_sign(const bignum* a) {
+  return a->sign;
+}
+
+/*
+  Functions working on the magnitudes only. They all assume the result does not overlap with
+  the operands.
+*/
+
+static int mag_cmp(const unsigned int* a, int na, const unsigned int* b, int nb) {
+  int i;
+
+  if( na != nb )
+    return na < nb ? -1 : 1;
+  for( i = na - 1; i >= 0; i-- ) {
+    if( a[i] != b[i] )
+      return a[i] < b[i] ? -1 : 1;
+  }
+  return 0;
+}
+
+static int mag_add(unsigned int* r, const unsigned int* a, int na, const unsigned int* b, int nb) {
+  unsigned long long carry = 0;
+  int i;
+
+  if( na < nb )
+    return mag_add(r, b, nb, a, na);
+
+  for( i = 0; i < na; i++ ) {
+    carry += (unsigned long long) a[i] + (i < nb ? b[i] : 0);
+    r[i] = (unsigned int) carry;
+    carry >>= 32;
+  }
+  r[na] = (unsigned int) carry;
+
+  return na + 1;
+}
+
+//Computes a - b, with |a| >= |b|
+
+static int mag_sub(unsigned int* r, const unsigned int* a, int na, const unsigned int* b, int nb) {
+  long long borrow = 0, t;
+  int i;
+
+  for( i = 0; i < na; i++ ) {
+    t = (long long) a[i] - (i < nb ? b[i] : 0) - borrow;
+    borrow = t < 0;
+    r[i] = (unsigned int) (t + (borrow << 32));
+  }
+
+  return na;
+}
+
+static int mag_mul(unsigned int* r, const unsigned int* a, int na, const unsigned int* b, int nb) {
+  unsigned long long t;
+  int i, j;
+
+  memset(r, 0, (na + nb) * sizeof(unsigned int));
+  for( i = 0; i < na; i++ ) {
+    t = 0;
+    for( j = 0; j < nb; j++ ) {
+      t += (unsigned long long) a[i] * b[j] + r[i + j];
+      r[i + j] = (unsigned int) t;
+      t >>= 32;
+    }
+    r[i + nb] = (unsigned int) t;
+  }
+
+  return na + nb;
+}
+
+static int nlz(unsigned int x) {
+  int n = 0;
+
+  if( x == 0 )
+    return 32;
+  while( !(x & 0x80000000U) ) {
+    x <<= 1;
+    n++;
+  }
+  return n;
+}
+
+/*
+  Knuth's algorithm D. u has m limbs, v has n limbs, with m >= n and v[n-1] != 0. The quotient
+  (m-n+1 limbs) goes in q and the remainder (n limbs) in r.
+*/
+
+static void mag_divmod(unsigned int* q, unsigned int* r, const unsigned int* u, int m, const unsigned int* v, int n) {
+  const unsigned long long b = 4294967296ULL;
+  unsigned long long qhat, rhat, p;
+  long long t, k;
+  unsigned int *un, *vn;
+  unsigned int unbuf[64], vnbuf[64];
+  int s, i, j;
+
+  if( n == 1 ) {
+    k = 0;
+    for( j = m - 1; j >= 0; j-- ) {
+      q[j] = (unsigned int) (((unsigned long long) k * b + u[j]) / v[0]);
+      k = (long long) (((unsigned long long) k * b + u[j]) - (unsigned long long) q[j] * v[0]);
+    }
+    r[0] = (unsigned int) k;
+    return;
+  }
+
+  /*
+    We normalize the divisor, shifting it so that its most significant bit is set: this way the
+    estimate qhat is never more than 2 units too large.
+  */
+  s = nlz(v[n - 1]);
+  //Small numbers (the common case) don't need the heap
+  vn = n <= 64 ? vnbuf : (unsigned int*) malloc(n * sizeof(unsigned int));
+  un = m < 64 ? unbuf : (unsigned int*) malloc((m + 1) * sizeof(unsigned int));
+
+  for( i = n - 1; i > 0; i-- )
+    vn[i] = (v[i] << s) | (unsigned int) ((unsigned long long) v[i - 1] >> (32 - s));
+  vn[0] = v[0] << s;
+
+  un[m] = (unsigned int) ((unsigned long long) u[m - 1] >> (32 - s));
+  for( i = m - 1; i > 0; i-- )
+    un[i] = (u[i] << s) | (unsigned int) ((unsigned long long) u[i - 1] >> (32 - s));
+  un[0] = u[0] << s;
+
+  for( j = m - n; j >= 0; j-- ) {
+    qhat = ((unsigned long long) un[j + n] * b + un[j + n - 1]) / vn[n - 1];
+    rhat = ((unsigned long long) un[j + n] * b + un[j + n - 1]) - qhat * vn[n - 1];
+
+    while( qhat >= b || qhat * vn[n - 2] > b * rhat + un[j + n - 2] ) {
+      qhat--;
+      rhat += vn[n - 1];
+      if( rhat >= b )
+        break;
+    }
+
+    //Multiply and subtract
+    k = 0;
+    for( i = 0; i < n; i++ ) {
+      p = qhat * vn[i];
+      t = (long long) un[i + j] - k - (long long) (p & 0xFFFFFFFFULL);
+      un[i + j] = (unsigned int) t;
+      k = (long long) (p >> 32) - (t >> 32);
+    }
+    t = (long long) un[j + n] - k;
+    un[j + n] = (unsigned int) t;
+
+    q[j] = (unsigned int) qhat;
+
+    //If we subtracted too much, add back
+    if( t < 0 ) {
+      q[j]--;
+      k = 0;
+      for( i = 0; i < n; i++ ) {
+        t = (long long) un[i + j] + vn[i] + k;
+        un[i + j] = (unsigned int) t;
+        k = t >> 32;
+      }
+      un[j + n] += (unsigned int) k;
+    }
+  }
+
+  for( i = 0; i < n - 1; i++ )
+    r[i] = (un[i] >> s) | (unsigned int) ((unsigned long long) un[i + 1] << (32 - s));
+  r[n - 1] = un[n - 1] >> s;
+
+  if( un != unbuf )
+    free(un);
+  if( vn != vnbuf )
+    free(vn);
+}
+
+int bn_cmp(const bignum* a, const bignum* b) {
+  if( a->sign != b->sign )
+    return a->sign < b->sign ? -1 : 1;
+
+  return a->sign * mag_cmp(a->limb, a->size, b->limb, b->size);
+}
+
+/*
+  Sum of two signed numbers. bsign lets bn_sub reuse the same code with the sign of b flipped.
+*/
+
+static void bn_add_signed(bignum* r, const bignum* a, const bignum* b, int bsign) {
+  bignum t;
+  int c, inplace = (r != a && r != b);
+
+  if( b->sign == 0 ) {
+    bn_copy(r, a);
+    return;
+  }
+  if( a->sign == 0 ) {
+    bn_copy(r, b);
+    r->sign = bsign;
+    return;
+  }
+
+  //When the result doesn't overlap with the operands we can reuse its buffer
+  if( inplace )
+    t = *r;
+  else
+    bn_init(&t);
+  bn_reserve(&t, (a->size > b->size ? a->size : b->size) + 1);
+
+  if( a->sign == bsign ) {
+    t.size = mag_add(t.limb, a->limb, a->size, b->limb, b->size);
+    t.sign = a->sign;
+  }
+  else {
+    c = mag_cmp(a->limb, a->size, b->limb, b->size);
+    if( c >= 0 ) {
+      t.size = mag_sub(t.limb, a->limb, a->size, b->limb, b->size);
+      t.sign = a->sign;
+    }
+    else {
+      t.size = mag_sub(t.limb, b->limb, b->size, a->limb, a->size);
+      t.sign = bsign;
+    }
+  }
+  bn_normalize(&t);
+
+  if( !inplace )
+    bn_free(r);
+  *r = t;
+}
+
+void bn_add(bignum* r, const bignum* a, const bignum* b) {
+  bn_add_signed(r, a, b, b->sign);
+}
+
+void bn_sub(bignum* r, const bignum* a, const bignum* b) {
+  bn_add_signed(r, a, b, -b->sign);
+}
+
+void bn_mul(bignum* r, const bignum* a, const bignum* b) {
+  bignum t;
+  int inplace = (r != a && r != b);
+
+  if( a->sign == 0 || b->sign == 0 ) {
+    r->sign = 0;
+    r->size = 0;
+    return;
+  }
+
+  if( inplace )
+    t = *r;
+  else
+    bn_init(&t);
+  bn_reserve(&t, a->size + b->size);
+  t.size = mag_mul(t.limb, a->limb, a->size, b->limb, b->size);
+  t.sign = a->sign * b->sign;
+  bn_normalize(&t);
+
+  if( !inplace )
+    bn_free(r);
+  *r = t;
+}
+
+void bn_divmod(bignum* q, bignum* rem, const bignum* a, const bignum* b) {
+  bignum tq, tr;
+
+  if( b->sign == 0 ) {
+    fprintf(stderr,"Bignum division by zero, aborting\n");
+    exit(1);
+  }
+
+  bn_init(&tq);
+  bn_init(&tr);
+
+  if( mag_cmp(a->limb, a->size, b->limb, b->size) < 0 ) {
+    bn_copy(&tr, a);
+  }
+  else {
+    bn_reserve(&tq, a->size - b->size + 1);
+    bn_reserve(&tr, b->size);
+    mag_divmod(tq.limb, tr.limb, a->limb, a->size, b->limb, b->size);
+    tq.size = a->size - b->size + 1;
+    tq.sign = a->sign * b->sign;
+    tr.size = b->size;
+    tr.sign = a->sign;
+    bn_normalize(&tq);
+    bn_normalize(&tr);
+  }
+
+  if( q ) {
+    bn_free(q);
+    *q = tq;
+  }
+  else
+    bn_free(&tq);
+
+  if( rem ) {
+    bn_free(rem);
+    *rem = tr;
+  }
+  else
+    bn_free(&tr);
+
+}
+
+void bn_gcd(bignum* r, const bignum* a, const bignum* b) {
+  bignum x, y, t;
+
+  bn_init(&x); bn_init(&y); bn_init(&t);
+  bn_copy(&x, a);
+  bn_copy(&y, b);
+  x.sign = x.size ? 1 : 0;
+  y.sign = y.size ? 1 : 0;
+
+  while( y.sign != 0 ) {
+    bn_divmod(0, &t, &x, &y);
+    bn_copy(&x, &y);
+    bn_copy(&y, &t);
+  }
+
+  bn_free(r);
+  *r = x;
+  bn_free(&y);
+  bn_free(&t);
+}
+
+/*
+  Decimal conversion: we repeatedly divide by 10^9, so that each division gives us nine digits.
+*/
+
+char* bn_to_string(const bignum* a) {
+  unsigned int* chunks;
+  unsigned int* mag;
+  unsigned long long rem;
+  int nchunks = 0, size = a->size, i;
+  char* s;
+  char* p;
+
+  if( a->sign == 0 ) {
+    s = (char*) malloc(2);
+    strcpy(s, "0");
+    return s;
+  }
+
+  mag = (unsigned int*) malloc(size * sizeof(unsigned int));
+  memcpy(mag, a->limb, size * sizeof(unsigned int));
+  chunks = (unsigned int*) malloc((size * 10 / 9 + 2) * sizeof(unsigned int));
+
+  do {
+    rem = 0;
+    for( i = size - 1; i >= 0; i-- ) {
+      rem = (rem << 32) | mag[i];
+      mag[i] = (unsigned int) (rem / 1000000000ULL);
+      rem %= 1000000000ULL;
+    }
+    chunks[nchunks++] = (unsigned int) rem;
+    while( size > 0 && mag[size - 1] == 0 )
+      size--;
+  } while( size > 0 );
+
+  s = (char*) malloc(nchunks * 9 + 2);
+  p = s;
+  if( a->sign < 0 )
+    *p++ = '-';
+  p += sprintf(p, "%u", chunks[nchunks - 1]);
+  for( i = nchunks - 2; i >= 0; i-- )
+    p += sprintf(p, "%09u", chunks[i]);
+
+  free(chunks);
+  free(mag);
+  return s;
+}
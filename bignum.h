@@ -0,0 +1,50 @@
+#ifndef BIGNUM_H
+#define BIGNUM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+  Minimal arbitrary precision integers, used by the exact pivoting engine only for the rows
+  of the tableaus that do not fit anymore in 64 bits. The magnitude is stored in base 2^32,
+  least significant limb first.
+*/
+
+typedef struct bignum_ {
+  int sign;
+  int size;
+  int alloc;
+  unsigned int* limb;
+} bignum;
+
+//Initialization and memory managment
+void bn_init(bignum*);
+void bn_free(bignum*);
+
+//Conversions from and to machine integers. bn_get_ll returns 0 if the number does not fit in a long long
+void bn_set_ll(bignum*, long long);
+void bn_set_i128(bignum*, __int128);
+int bn_get_ll(const bignum*, long long*);
+void bn_copy(bignum* r, const bignum* a);
+
+//Returns the nearest double (it may overflow to infinity for huge numbers)
+double bn_to_double(const bignum*);
+
+//Returns the decimal representation of the number in a newly allocated string
+char* bn_to_string(const bignum*);
+
+int bn_sign(const bignum*);
+int bn_cmp(const bignum*, const bignum*);
+
+//Arithmetic: the result can be the same object of one of the operands
+void bn_add(bignum* r, const bignum* a, const bignum* b);
+void bn_sub(bignum* r, const bignum* a, const bignum* b);
+void bn_mul(bignum* r, const bignum* a, const bignum* b);
+
+//Truncated division: a = q*b + rem, with rem having the sign of a. q or rem can be NULL
+void bn_divmod(bignum* q, bignum* rem, const bignum* a, const bignum* b);
+
+//Greatest common divisor of the absolute values
+void bn_gcd(bignum* r, const bignum* a, const bignum* b);
+
+#endif
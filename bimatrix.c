@@ -1,5 +1,28 @@
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
 #include "bimatrix.h"
 
+/*
+  The payoffs of both players are kept in a single contiguous block, A row by row followed by B:
+  the row pointers are only an index on it. This is what the random generator fills and what the
+  binary game files contain.
+*/
+
+double **alloc_bimatrix(int dim1, int dim2)
+{
+  int i;
+
+  double **bimatrix = (double **) malloc(sizeof(double *) * 2 * dim1);
+  bimatrix[0] = (double *) malloc(sizeof(double) * 2 * dim1 * dim2);
+  for (i = 1; i < (2 * dim1); i++)
+    bimatrix[i] = bimatrix[0] + (long) i * dim2;
+
+  return bimatrix;
+}
+
 /*
   Gets a random dim1 x dim2 bimatrix. The values are drawn from a uniform random 
   distribution with mean zero and extremal values of -1.0 and +1.0. We seed the
@@ -10,57 +33,88 @@
 
 double **get_random_bimatrix_gen(int dim1, int dim2, double *min)
 {
-  int i;
-  double n1, n2;
-
-  double **bimatrix = (double **) malloc(sizeof(double *) * 2 * dim1);
-  for (i = 0; i < (2 * dim1); i++)
-    bimatrix[i] = (double *) malloc(sizeof(double) * dim2);
-
-  /*
-    As we said, we need to use srand48 instead of the usual srand() pseudo-random
-    generator.
-  */
-
   struct timeval tim;
   gettimeofday(&tim, NULL);
-  srand48((long) (tim.tv_sec * 1000000 + tim.tv_usec));
-  *min = 1000000;
 
-  for (i = 0; i < (dim1 * dim2); i++) {
-    n1 = 2.0 * drand48() - 1.0;
-    n2 = 2.0 * drand48() - 1.0;
+  return get_random_bimatrix_seeded(dim1, dim2, (uint64_t) (tim.tv_sec * 1000000 + tim.tv_usec), 0, 0, min);
+}
 
-    bimatrix[i % dim1][i / dim1] = n1;
-    bimatrix[i % dim1 + dim1][i / dim1] = n2;
+/*
+  Same as above, but the game is a function of (seed, index) only: the payoffs are drawn from the
+  counter-based Philox generator, which can compute each of them independently, so the block is
+  filled in parallel by 'threads' threads (0 chooses automatically) without changing the game.
+*/
 
-    *min = *min < (n1 < n2 ? n1 : n2) ? *min : (n1 < n2 ? n1 : n2);
-  }
+double **get_random_bimatrix_seeded(int dim1, int dim2, uint64_t seed, uint64_t index, int threads, double *min)
+{
+  double **bimatrix = alloc_bimatrix(dim1, dim2);
+
+  *min = philox_fill_parallel(bimatrix[0], 2L * dim1 * dim2, seed, index, threads);
 
   return bimatrix;
 }
 
 /*
-  Creates (and allocates necessary memory) the two tableaus needed by the algorithm,
-  starting from the bimatrix. 
+  File backing the arena of the tableaus, for the out-of-core mode (NULL for memory). The file is
+  removed as soon as it is mapped, so that its space is given back however the program ends: it must
+  be a new file, as an existing one would be lost.
 */
 
-double*** create_systems(double** bimatrix, int dim1, int dim2) {  
-  int i, j;
-  
+static const char* tableau_file = 0;
+
+void set_tableau_file(const char* file) {
+  tableau_file = file;
+}
+
+static double* map_arena(long bytes) {
+  void* arena;
+  int fd = open(tableau_file, O_RDWR | O_CREAT | O_EXCL, 0600);
+
+  if( fd < 0 && errno == EEXIST ) {
+    fprintf(stderr,"The tableau file %s already exists: give the name of a new file\n",tableau_file);
+    exit(1);
+  }
+  if( fd < 0 || ftruncate(fd, bytes) != 0 ) {
+    if( fd >= 0 )
+      unlink(tableau_file);
+    fprintf(stderr,"Cannot create the tableau file %s\n",tableau_file);
+    exit(1);
+  }
+  arena = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if( arena == MAP_FAILED ) {
+    unlink(tableau_file);
+    fprintf(stderr,"Cannot map the tableau file %s\n",tableau_file);
+    exit(1);
+  }
+  close(fd);
+  unlink(tableau_file);
+  return (double*) arena;
+}
+
+/*
+  Allocates the two tableaus needed by the algorithm. All their rows are taken from a single arena,
+  the rows of the first tableau followed by those of the second one, and are initialized as described
+  in create_systems, except for the payoffs, which are left to zero. A new file is all zeros, as the
+  memory from calloc.
+*/
+
+double*** alloc_tableaus(int dim1, int dim2) {
+  int i;
+  int width = 2 + dim1 + dim2;
+  long bytes = (long) (dim1 + dim2) * width * sizeof(double);
+
   double*** tableaus = (double***) malloc( 2 * sizeof(double**) );
+  double* arena = tableau_file ? map_arena(bytes) : (double*) calloc( (long) (dim1 + dim2) * width, sizeof(double) );
 
-  //Memory allocation for the two tableaus
-  
   tableaus[0] = (double**) malloc( dim1 * sizeof(double*) );
   for(i = 0; i < dim1; i++) {
-    tableaus[0][i] = (double*) calloc( (2 + dim1 + dim2), sizeof(double) );
+    tableaus[0][i] = arena + (long) i * width;
   }
   tableaus[1] = (double**) malloc( dim2 * sizeof(double*) );
   for(i = 0; i < dim2; i++) {
-    tableaus[1][i] = (double*) calloc( (2 + dim1 + dim2), sizeof(double) );
+    tableaus[1][i] = arena + (long) (dim1 + i) * width;
   }
-  
+
   /*
     Initialization of the two tableaus. The first column represents the index of the variable,
     with the convention that a negative number represents the slack variable associated with
@@ -78,6 +132,35 @@ double*** create_systems(double** bimatrix, int dim1, int dim2) {
     tableaus[1][i][1] = 1.0;
   }
 
+  return tableaus;
+}
+
+/*
+  Creates (and allocates necessary memory) the two tableaus needed by the algorithm,
+  starting from the bimatrix. 
+*/
+
+double*** create_systems(double** bimatrix, int dim1, int dim2) {  
+  double*** tableaus = alloc_tableaus(dim1, dim2);
+
+  load_systems(tableaus, bimatrix, dim1, dim2);
+  return tableaus;
+}
+
+void load_systems(double*** tableaus, double** bimatrix, int dim1, int dim2) {
+  int i, j;
+
+  //The tableaus may come from an earlier game: they go back to the slack basis of alloc_tableaus
+  memset(tableaus[0][0], 0, (long) (dim1 + dim2) * (2 + dim1 + dim2) * sizeof(double));
+  for (i = 0; i < dim1; i++) {
+    tableaus[0][i][0] = - i - 1.0;
+    tableaus[0][i][1] = 1.0;
+  }
+  for (i = 0; i < dim2; i++) {
+    tableaus[1][i][0] = - i - dim1 - 1.0;
+    tableaus[1][i][1] = 1.0;
+  }
+
   /*
     We now only need to copy the bimatrix in the correct cells in the tableau.
   */
@@ -91,10 +174,158 @@ double*** create_systems(double** bimatrix, int dim1, int dim2) {
       tableaus[1][i][j] = - bimatrix[dim1 + ( j - 2 - dim2)][i];
     }
   }
+}
+
+/*
+  Low memory load path: the readers and the generator below write the payoffs straight into the
+  tableaus, negated as create_systems does, without ever building the bimatrix. The minimum is
+  tracked while reading, so the offset of positivize_bimatrix can only be applied at the end, by
+  positivize_systems: -(a - (min - 1)) and -a + (min - 1) are the same double, so the tableaus are
+  exactly those that create_systems would build from the positivized bimatrix.
+*/
+
+static inline void store_payoffs(double*** tableaus, int dim1, int dim2, int i, int j, double a, double b) {
+  tableaus[0][i][2 + dim1 + j] = -a;
+  tableaus[1][j][2 + dim2 + i] = -b;
+}
+
+double*** gamut_import_systems(FILE *f, double *minimo, int* rdim1, int* rdim2) {
+  int i, j, dim1, dim2;
+  double n1, n2;
+  double*** tableaus;
+
+  gamut_read_header(f, &dim1, &dim2);
+  *rdim1 = dim1; *rdim2 = dim2;
+  tableaus = alloc_tableaus(dim1, dim2);
+
+  *minimo = 1000000;
+
+  for(i = 0; i < dim2; i++) {
+    for(j = 0; j < dim1; j++) {
+      fscanf(f,"%lf %lf ",&n1,&n2);
+      *minimo = *minimo < (n1 < n2 ? n1 : n2) ? *minimo : (n1 < n2 ? n1 : n2);
+      store_payoffs(tableaus, dim1, dim2, j, i, n1, n2);
+    }
+  }
+
+  return tableaus;
+}
+
+double*** binary_import_systems(FILE *f, double *minimo, int* rdim1, int* rdim2) {
+  int i, j, dim1, dim2;
+  double* row;
+  double*** tableaus;
+
+  binary_read_header(f, &dim1, &dim2);
+  *rdim1 = dim1; *rdim2 = dim2;
+  tableaus = alloc_tableaus(dim1, dim2);
+  row = (double*) malloc(dim2 * sizeof(double));
+
+  *minimo = 1000000;
+
+  //The file holds A and then B, row by row: we need only one row at a time
+  for(i = 0; i < (2 * dim1); i++) {
+    if( fread(row, sizeof(double), dim2, f) != (size_t) dim2 ) {
+      fprintf(stderr,"Binary game file truncated, aborting\n");
+      exit(1);
+    }
+    for(j = 0; j < dim2; j++) {
+      *minimo = *minimo < row[j] ? *minimo : row[j];
+      if( i < dim1 )
+	tableaus[0][i][2 + dim1 + j] = -row[j];
+      else
+	tableaus[1][j][2 + dim2 + i - dim1] = -row[j];
+    }
+  }
+
+  free(row);
+  return tableaus;
+}
+
+/*
+  The random game of get_random_bimatrix_seeded, generated one row at a time: since the generator is
+  counter-based, the payoff in a given position has the same value whatever the order.
+*/
+
+double*** get_random_systems_seeded(int dim1, int dim2, uint64_t seed, uint64_t index, double *minimo) {
+  int i, j;
+  double* row = (double*) malloc(dim2 * sizeof(double));
+  double*** tableaus = alloc_tableaus(dim1, dim2);
+
+  *minimo = 1000000;
+
+  for(i = 0; i < (2 * dim1); i++) {
+    philox_fill(row, dim2, seed, index, (uint64_t) i * dim2);
+    for(j = 0; j < dim2; j++) {
+      *minimo = *minimo < row[j] ? *minimo : row[j];
+      if( i < dim1 )
+	tableaus[0][i][2 + dim1 + j] = -row[j];
+      else
+	tableaus[1][j][2 + dim2 + i - dim1] = -row[j];
+    }
+  }
 
+  free(row);
   return tableaus;
 }
 
+void positivize_systems(double*** tableaus, int dim1, int dim2, double minimo) {
+  int i, j;
+
+  for(i = 0; i < dim1; i++) {
+    for(j = 2 + dim1; j < (2 + dim1 + dim2); j++) {
+      tableaus[0][i][j] += (minimo - 1.0);
+    }
+  }
+  for(i = 0; i < dim2; i++) {
+    for(j = 2 + dim2; j < (2 + dim1 + dim2); j++) {
+      tableaus[1][i][j] += (minimo - 1.0);
+    }
+  }
+}
+
+/*
+  Symmetric games: the payoff of the second player B[i][j] is the payoff A[j][i] of the first player
+  in the transposed situation.
+*/
+
+int is_symmetric_bimatrix(double** bimatrix, int dim1, int dim2) {
+  int i, j;
+
+  if( dim1 != dim2 )
+    return 0;
+
+  for (i = 0; i < dim1; i++) {
+    for (j = 0; j < dim2; j++) {
+      if( bimatrix[dim1 + i][j] != bimatrix[j][i] )
+	return 0;
+    }
+  }
+
+  return 1;
+}
+
+/*
+  The tableau of a symmetric game is just the first tableau of create_systems: the second one would
+  contain the same coefficients.
+*/
+
+double** create_symmetric_system(double** bimatrix, int dim) {
+  int i, j;
+
+  double** tableau = (double**) malloc( dim * sizeof(double*) );
+  for(i = 0; i < dim; i++) {
+    tableau[i] = (double*) calloc( (2 + 2 * dim), sizeof(double) );
+    tableau[i][0] = - i - 1.0;
+    tableau[i][1] = 1.0;
+    for (j = (2 + dim); j < (2 * dim + 2); j++) {
+      tableau[i][j] = - bimatrix[i][j - 2 - dim];
+    }
+  }
+
+  return tableau;
+}
+
 void view_bimatrix_gen(double** bimatrix, int dim1, int dim2, FILE *f) {
   int i, j;
 
@@ -196,20 +427,15 @@ int get_column(int dim1, int dim2, int strategy) {
 }
 
 /*
-  This is the main function needed to import a normal form game in Gambit NFG format.
-  In fact it accepts only one of the two normal form game formats: only files starting
-  with the "NFG 1 D" identification string will be accepted by the program. This, by the
-  way, is the format used by GAMUT to export games.
+  Reads the header of a NFG file, up to the dimensions of the game: after it, the payoffs follow.
 */
 
-double** gamut_import_bimatrix(FILE *f, double *minimo, int* rdim1, int* rdim2) 
+void gamut_read_header(FILE *f, int* dim1, int* dim2)
 {
   char *buf = (char *) malloc(100 * sizeof(char));
-  char c;
-  int i, j, tmpn;
+  int c;
+  int tmpn;
   size_t num_bytes = 100;
-  int dim1, dim2; 
-  double n1, n2;
 
   /*
     This checks if we are parsing the correct file type.
@@ -227,26 +453,50 @@ double** gamut_import_bimatrix(FILE *f, double *minimo, int* rdim1, int* rdim2)
   tmpn = 0;
   while(tmpn < 2) { //This is to ignore comments
     c = fgetc(f);
+    if( c == EOF ) {
+      fprintf(stderr,"NFG file corrupted, aborting\n");
+      exit(1);
+    }
     if( c == '\"' )
       tmpn++;
   }
   tmpn = 0;
   while(tmpn < 2) { //And this ignores player names
     c = fgetc(f);
+    if( c == EOF ) {
+      fprintf(stderr,"NFG file corrupted, aborting\n");
+      exit(1);
+    }
     if( c == '{' || c == '}')
       tmpn++;
   }
   
-  fscanf(f,"%d %d",&dim1,&dim2);
-  *rdim1 = dim1; *rdim2 = dim2;
+  fscanf(f,"%d %d",dim1,dim2);
   fgetc(f); fgetc(f);
 
+  free(buf);
+}
+
+/*
+  This is the main function needed to import a normal form game in Gambit NFG format.
+  In fact it accepts only one of the two normal form game formats: only files starting
+  with the "NFG 1 D" identification string will be accepted by the program. This, by the
+  way, is the format used by GAMUT to export games.
+*/
+
+double** gamut_import_bimatrix(FILE *f, double *minimo, int* rdim1, int* rdim2) 
+{
+  int i, j;
+  int dim1, dim2; 
+  double n1, n2;
+
+  gamut_read_header(f, &dim1, &dim2);
+  *rdim1 = dim1; *rdim2 = dim2;
+
   /*
     We need now to allocate memory for the bimatrix, as we just determined the dimension of the game.
   */
-  double **bimatrix = (double **) malloc(sizeof(double *) * 2 * dim1);
-  for (i = 0; i < (2 * dim1); i++)
-    bimatrix[i] = (double *) malloc(sizeof(double) * dim2);
+  double **bimatrix = alloc_bimatrix(dim1, dim2);
   
   *minimo = 1000000;
   
@@ -258,32 +508,117 @@ double** gamut_import_bimatrix(FILE *f, double *minimo, int* rdim1, int* rdim2)
     }
   }
 
-  free(buf);
   return bimatrix;
 }
 
 
-void free_tableaus(double*** tableaus, int dim1, int dim2) {
-  int i;
+/*
+  Binary game files: the magic string, the two dimensions as 32 bit integers and then the contiguous
+  block of payoffs as it is in memory (A row by row, then B). They are meant for big benchmark games,
+  which would take a long time to be parsed from text, and are not portable between machines with
+  different byte order.
+*/
+
+int is_binary_game(FILE *f) {
+  char magic[BIMATRIX_MAGIC_LEN];
+  int binary;
 
-  for(i=0; i < dim1; i++) {
-    free(tableaus[0][i]);
+  binary = fread(magic, 1, BIMATRIX_MAGIC_LEN, f) == BIMATRIX_MAGIC_LEN && memcmp(magic, BIMATRIX_MAGIC, BIMATRIX_MAGIC_LEN) == 0;
+  rewind(f);
+
+  return binary;
+}
+
+void binary_read_header(FILE *f, int* dim1, int* dim2)
+{
+  char magic[BIMATRIX_MAGIC_LEN];
+  int32_t dims[2];
+
+  if( fread(magic, 1, BIMATRIX_MAGIC_LEN, f) != BIMATRIX_MAGIC_LEN || memcmp(magic, BIMATRIX_MAGIC, BIMATRIX_MAGIC_LEN) != 0 ||
+      fread(dims, sizeof(int32_t), 2, f) != 2 || dims[0] <= 0 || dims[1] <= 0 ) {
+    fprintf(stderr,"Binary game file corrupted, aborting\n");
+    exit(1);
   }
-  free(tableaus[0]);
 
-  for(i=0; i < dim2; i++) {
-    free(tableaus[1][i]);
+  *dim1 = dims[0]; *dim2 = dims[1];
+}
+
+double** binary_import_bimatrix(FILE *f, double *minimo, int* rdim1, int* rdim2)
+{
+  long i, n;
+  double **bimatrix;
+
+  binary_read_header(f, rdim1, rdim2);
+  n = 2L * *rdim1 * *rdim2;
+  bimatrix = alloc_bimatrix(*rdim1, *rdim2);
+
+  if( fread(bimatrix[0], sizeof(double), n, f) != (size_t) n ) {
+    fprintf(stderr,"Binary game file truncated, aborting\n");
+    exit(1);
   }
-  free(tableaus[1]);
 
+  *minimo = 1000000;
+  for(i = 0; i < n; i++)
+    *minimo = *minimo < bimatrix[0][i] ? *minimo : bimatrix[0][i];
+
+  return bimatrix;
+}
+
+void binary_export_bimatrix(double** bimatrix, int dim1, int dim2, FILE *f)
+{
+  int32_t dims[2] = { dim1, dim2 };
+  int i;
+
+  fwrite(BIMATRIX_MAGIC, 1, BIMATRIX_MAGIC_LEN, f);
+  fwrite(dims, sizeof(int32_t), 2, f);
+  //The rows are written one by one, so that this works on bimatrices that are not contiguous too
+  for(i = 0; i < (2 * dim1); i++)
+    fwrite(bimatrix[i], sizeof(double), dim2, f);
+}
+
+/*
+  Writes the game in the NFG format read by gamut_import_bimatrix, with enough digits to read back
+  the same doubles.
+*/
+
+void nfg_export_bimatrix(double** bimatrix, int dim1, int dim2, const char* title, FILE *f)
+{
+  int i, j;
+
+  fprintf(f,"NFG 1 D \"%s\"\n{ \"Player 1\" \"Player 2\" } { %d %d }\n\n",title,dim1,dim2);
+
+  for(j = 0; j < dim2; j++) {
+    for(i = 0; i < dim1; i++) {
+      fprintf(f,"%.17g %.17g ",bimatrix[i][j],bimatrix[dim1 + i][j]);
+    }
+    fprintf(f,"\n");
+  }
+}
+
+//The rows are never exchanged by the pivoting, so the first row of the first tableau is still the start of the arena
+void free_tableaus(double*** tableaus, int dim1, int dim2) {
+  if( tableau_file )
+    munmap(tableaus[0][0], (long) (dim1 + dim2) * (2 + dim1 + dim2) * sizeof(double));
+  else
+    free(tableaus[0][0]);
+  free(tableaus[0]);
+  free(tableaus[1]);
   free(tableaus);
 }
 
-void free_bimatrix(double** bimatrix, int dim1, int dim2) {
+void free_symmetric_system(double** tableau, int dim) {
   int i;
 
-  for(i=0; i < (2*dim1); i++) {
-    free(bimatrix[i]);
+  for(i=0; i < dim; i++) {
+    free(tableau[i]);
   }
+  free(tableau);
+}
+
+void free_bimatrix(double** bimatrix, int dim1, int dim2) {
+  //The rows share the single block of alloc_bimatrix: the dimensions are kept for the callers only
+  (void) dim1;
+  (void) dim2;
+  free(bimatrix[0]);
   free(bimatrix);
 }
@@ -1,3 +1,6 @@
+#ifndef BIMATRIX_H
+#define BIMATRIX_H
+
 #define _GNU_SOURCE
 #include <sys/time.h>
 
@@ -6,10 +9,16 @@
 #include <assert.h>
 #include <math.h>
 #include <string.h>
+#include <stdint.h>
 #include "equilibria.h"
+#include "philox.h"
 
 #define eps 1e-20
 
+//Identification string of the binary game files
+#define BIMATRIX_MAGIC "LHGAME01"
+#define BIMATRIX_MAGIC_LEN 8
+
 typedef struct sh_tab {
   int row;
   int label;
@@ -20,12 +29,51 @@ typedef struct sh_tab {
 //Imports a bimatrix from a NFG file.
 double** gamut_import_bimatrix(FILE *, double *min, int* rdim1, int* rdim2);
 
+//Reads the header of a NFG file or of a binary game file, up to the dimensions of the game
+void gamut_read_header(FILE *, int* dim1, int* dim2);
+void binary_read_header(FILE *, int* dim1, int* dim2);
+
+//Imports a bimatrix from a binary game file, and tells if a file is one
+double** binary_import_bimatrix(FILE *, double *min, int* rdim1, int* rdim2);
+int is_binary_game(FILE *);
+
+//Writes the bimatrix to a binary game file or to a NFG file
+void binary_export_bimatrix(double** bimatrix, int dim1, int dim2, FILE *);
+void nfg_export_bimatrix(double** bimatrix, int dim1, int dim2, const char* title, FILE *);
+
+//Allocates a bimatrix on a single contiguous block
+double** alloc_bimatrix(int dim1, int dim2);
+
 //Gets a uniformely random dim1xdim2 bimatrix.
 double** get_random_bimatrix_gen(int dim1, int dim2, double *);
 
+//Gets the random bimatrix number 'index' of the given seed, generated by 'threads' threads (0 for automatic)
+double** get_random_bimatrix_seeded(int dim1, int dim2, uint64_t seed, uint64_t index, int threads, double *);
+
 //Creates the tableaus starting from the bimatrix
 double*** create_systems(double** bimatrix,int dim1, int dim2);
 
+//Allocates the tableaus on a single arena, with all payoffs set to zero
+double*** alloc_tableaus(int dim1, int dim2);
+
+//From now on the arena of the tableaus is mapped on this file instead of being allocated in memory. The file must not exist
+void set_tableau_file(const char* file);
+
+//Loads a game in tableaus of the same size allocated earlier, as create_systems would build them
+void load_systems(double*** tableaus, double** bimatrix, int dim1, int dim2);
+
+//Low memory load path: the payoffs go directly in the tableaus, there is no bimatrix. positivize_systems must be called before pivoting
+double*** gamut_import_systems(FILE *, double *min, int* rdim1, int* rdim2);
+double*** binary_import_systems(FILE *, double *min, int* rdim1, int* rdim2);
+double*** get_random_systems_seeded(int dim1, int dim2, uint64_t seed, uint64_t index, double *);
+void positivize_systems(double*** tableaus, int dim1, int dim2, double min);
+
+//Tells if the game is symmetric (square, with B equal to A transposed)
+int is_symmetric_bimatrix(double** bimatrix, int dim1, int dim2);
+
+//Creates the single tableau used for symmetric games
+double** create_symmetric_system(double** bimatrix, int dim);
+
 //Adds an offset to all payoffs to have them positive
 void positivize_bimatrix(double** bimatrix,int dim1, int dim2, double min);
 
@@ -48,3 +96,6 @@ int get_column(int dim1, int dim2, int strategy);
 //Memory managment functions
 void free_tableaus(double*** tableaus, int dim1, int dim2);
 void free_bimatrix(double** bimatrix, int dim1, int dim2);
+void free_symmetric_system(double** tableau, int dim);
+
+#endif
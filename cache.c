@@ -0,0 +1,430 @@
+/*
+  Result cache library.
+
+  Many workloads submit the same game again and again, so we keep the results we already computed,
+  identified by a hash of the game and of the options of the solver. There are two tiers:
+
+  - An in-memory LRU cache (a chained hash table plus a doubly linked list ordered by last use).
+  - An optional on-disk cache: a file of fixed size slots, memory mapped and shared between all the
+    processes using it. Slots are addressed by the hash with a short linear probing, and access
+    is serialized with flock.
+
+  Results are stored in serialized form: the pivot count, then for each equilibrium the list of
+  (label, probability, exact probability) of its strategies.
+*/
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "cache.h"
+
+#define CACHE_MAGIC "LHCACHE1"
+#define CACHE_SLOT_TAG 0x4c48534c  //"LHSL", written in each slot with its blob
+
+typedef struct disk_header_ {
+  char magic[8];
+  int nslots;
+  int slotsize;
+} disk_header;
+
+typedef struct disk_slot_ {
+  cache_key key;
+  int size;       //Size of the blob following the slot header, 0 if the slot is empty
+  int tag;        //CACHE_SLOT_TAG once the slot has been written
+} disk_slot;
+
+/*
+  Hashing: we combine 64 bit words with two independent multiply-xorshift mixers. Payoffs are
+  hashed by their bit pattern (with -0.0 counted as 0.0).
+*/
+
+static unsigned long long mix(unsigned long long h, unsigned long long v, unsigned long long m) {
+  h ^= v;
+  h *= m;
+  h ^= h >> 29;
+  return h;
+}
+
+void cache_make_key(cache_key* key, double** bimatrix, int dim1, int dim2, int pivot, int all, int engine) {
+  const unsigned long long m1 = 0x9E3779B97F4A7C15ULL, m2 = 0xC2B2AE3D27D4EB4FULL;
+  unsigned long long h1 = 0x243F6A8885A308D3ULL, h2 = 0x13198A2E03707344ULL, v;
+  double x;
+  int i, j;
+
+  v = ((unsigned long long) dim1 << 32) | (unsigned int) dim2;
+  h1 = mix(h1, v, m1); h2 = mix(h2, v, m2);
+  v = ((unsigned long long) (all ? 0 : pivot) << 32) | ((unsigned int) all << 16) | (unsigned int) engine;
+  h1 = mix(h1, v, m1); h2 = mix(h2, v, m2);
+
+  for(i = 0; i < (2 * dim1); i++) {
+    for(j = 0; j < dim2; j++) {
+      x = bimatrix[i][j] == 0.0 ? 0.0 : bimatrix[i][j];
+      memcpy(&v, &x, sizeof(v));
+      h1 = mix(h1, v, m1);
+      h2 = mix(h2, v, m2);
+    }
+  }
+
+  key->h1 = mix(h1, h2, m2);
+  key->h2 = mix(h2, h1, m1);
+}
+
+static int key_equal(cache_key* a, cache_key* b) {
+  return a->h1 == b->h1 && a->h2 == b->h2;
+}
+
+/*
+  Serialization of the results.
+*/
+
+static char* blob_put(char* p, const void* data, int size) {
+  memcpy(p, data, size);
+  return p + size;
+}
+
+char* serialize_eqlist(eqlist* list, int steps, int* size) {
+  eqlist* l;
+  equilibrium* e;
+  int n, len, total = 2 * sizeof(int);
+  char *blob, *p;
+
+  for(l = list; l != 0; l = l->next) {
+    total += sizeof(int);
+    for(e = l->eq; e != 0; e = e->next)
+      total += 2 * sizeof(int) + sizeof(double) + (e->exact ? strlen(e->exact) : 0);
+  }
+
+  blob = (char*) malloc(total);
+  p = blob;
+  n = 0;
+  for(l = list; l != 0; l = l->next)
+    n++;
+  p = blob_put(p, &steps, sizeof(int));
+  p = blob_put(p, &n, sizeof(int));
+
+  for(l = list; l != 0; l = l->next) {
+    n = eq_size(l->eq);
+    p = blob_put(p, &n, sizeof(int));
+    for(e = l->eq; e != 0; e = e->next) {
+      len = e->exact ? strlen(e->exact) : 0;
+      p = blob_put(p, &e->label, sizeof(int));
+      p = blob_put(p, &e->prob, sizeof(double));
+      p = blob_put(p, &len, sizeof(int));
+      if( len > 0 )
+	p = blob_put(p, e->exact, len);
+    }
+  }
+
+  *size = total;
+  return blob;
+}
+
+eqlist* deserialize_eqlist(const char* p, int* steps) {
+  eqlist *list = 0, *tail = 0, *node;
+  equilibrium* eq;
+  int neq, n, i, k, label, len;
+  double prob;
+  char* exact;
+
+  memcpy(steps, p, sizeof(int)); p += sizeof(int);
+  memcpy(&neq, p, sizeof(int)); p += sizeof(int);
+
+  for(i = 0; i < neq; i++) {
+    memcpy(&n, p, sizeof(int)); p += sizeof(int);
+    eq = 0;
+    for(k = 0; k < n; k++) {
+      memcpy(&label, p, sizeof(int)); p += sizeof(int);
+      memcpy(&prob, p, sizeof(double)); p += sizeof(double);
+      memcpy(&len, p, sizeof(int)); p += sizeof(int);
+      exact = 0;
+      if( len > 0 ) {
+	exact = (char*) malloc(len + 1);
+	memcpy(exact, p, len);
+	exact[len] = 0;
+	p += len;
+      }
+      eq = add_strategy_exact(eq, label, prob, exact);
+    }
+
+    //The list was serialized in order, so we just append
+    node = (eqlist*) malloc(sizeof(eqlist));
+    node->eq = eq;
+    node->id = 0;
+    node->paths = 0;
+    node->next = 0;
+    if( tail )
+      tail->next = node;
+    else
+      list = node;
+    tail = node;
+  }
+
+  return list;
+}
+
+/*
+  In-memory LRU tier.
+*/
+
+static void lru_unlink(result_cache* c, cache_entry* e) {
+  if( e->prev ) e->prev->next = e->next; else c->lru_head = e->next;
+  if( e->next ) e->next->prev = e->prev; else c->lru_tail = e->prev;
+  e->prev = e->next = 0;
+}
+
+static void lru_push_front(result_cache* c, cache_entry* e) {
+  e->prev = 0;
+  e->next = c->lru_head;
+  if( c->lru_head )
+    c->lru_head->prev = e;
+  c->lru_head = e;
+  if( !c->lru_tail )
+    c->lru_tail = e;
+}
+
+static cache_entry* memory_find(result_cache* c, cache_key* key) {
+  cache_entry* e;
+
+  for(e = c->buckets[key->h1 % c->nbuckets]; e != 0; e = e->hnext) {
+    if( key_equal(&e->key, key) )
+      return e;
+  }
+  return 0;
+}
+
+static void memory_evict(result_cache* c) {
+  cache_entry* e = c->lru_tail;
+  cache_entry** p;
+
+  lru_unlink(c, e);
+  for(p = &c->buckets[e->key.h1 % c->nbuckets]; *p != e; p = &(*p)->hnext)
+    ;
+  *p = e->hnext;
+
+  free(e->blob);
+  free(e);
+  c->nentries--;
+}
+
+static void memory_insert(result_cache* c, cache_key* key, const char* blob, int size) {
+  cache_entry* e = memory_find(c, key);
+
+  if( e ) {
+    lru_unlink(c, e);
+    lru_push_front(c, e);
+    return;
+  }
+
+  if( c->nentries >= c->capacity )
+    memory_evict(c);
+
+  e = (cache_entry*) malloc(sizeof(cache_entry));
+  e->key = *key;
+  e->size = size;
+  e->blob = (char*) malloc(size);
+  memcpy(e->blob, blob, size);
+  e->hnext = c->buckets[key->h1 % c->nbuckets];
+  c->buckets[key->h1 % c->nbuckets] = e;
+  lru_push_front(c, e);
+  c->nentries++;
+}
+
+/*
+  On-disk tier.
+*/
+
+static disk_slot* disk_slot_at(result_cache* c, int i) {
+  return (disk_slot*) (c->map + (size_t) CACHE_SLOT_SIZE * (1 + i));
+}
+
+static void disk_open(result_cache* c, const char* diskfile) {
+  struct stat st;
+  disk_header* h;
+
+  c->fd = open(diskfile, O_RDWR | O_CREAT, 0644);
+  if( c->fd < 0 ) {
+    fprintf(stderr,"Cannot open cache file %s, disk cache disabled\n",diskfile);
+    return;
+  }
+
+  /*
+    The first process that uses the file initializes it. The file is sparse, so unused slots
+    don't take space on disk.
+  */
+  flock(c->fd, LOCK_EX);
+  fstat(c->fd, &st);
+  c->mapsize = (size_t) CACHE_SLOT_SIZE * (1 + CACHE_DISK_SLOTS);
+  if( st.st_size == 0 ) {
+    if( ftruncate(c->fd, c->mapsize) != 0 ) {
+      flock(c->fd, LOCK_UN);
+      close(c->fd);
+      c->fd = -1;
+      return;
+    }
+  }
+  else
+    c->mapsize = st.st_size;
+
+  c->map = (char*) mmap(0, c->mapsize, PROT_READ | PROT_WRITE, MAP_SHARED, c->fd, 0);
+  if( c->map == MAP_FAILED ) {
+    fprintf(stderr,"Cannot map cache file %s, disk cache disabled\n",diskfile);
+    flock(c->fd, LOCK_UN);
+    close(c->fd);
+    c->fd = -1;
+    c->map = 0;
+    return;
+  }
+
+  h = (disk_header*) c->map;
+  if( st.st_size == 0 ) {
+    memcpy(h->magic, CACHE_MAGIC, 8);
+    h->nslots = CACHE_DISK_SLOTS;
+    h->slotsize = CACHE_SLOT_SIZE;
+  }
+  if( memcmp(h->magic, CACHE_MAGIC, 8) != 0 || h->slotsize != CACHE_SLOT_SIZE ||
+      (size_t) CACHE_SLOT_SIZE * (1 + h->nslots) > c->mapsize ) {
+    fprintf(stderr,"%s is not a valid cache file, disk cache disabled\n",diskfile);
+    flock(c->fd, LOCK_UN);
+    munmap(c->map, c->mapsize);
+    close(c->fd);
+    c->fd = -1;
+    c->map = 0;
+    return;
+  }
+  c->nslots = h->nslots;
+  flock(c->fd, LOCK_UN);
+}
+
+/*
+  The file is shared with other processes and can be damaged: a slot whose tag is wrong or whose size
+  doesn't fit in the slot is not trusted, and is treated as empty.
+*/
+
+static int slot_valid(disk_slot* s) {
+  return s->tag == CACHE_SLOT_TAG && s->size > 0 && s->size <= CACHE_SLOT_SIZE - (int) sizeof(disk_slot);
+}
+
+static char* disk_lookup(result_cache* c, cache_key* key, int* size) {
+  disk_slot* s;
+  char* blob = 0;
+  int i;
+
+  flock(c->fd, LOCK_SH);
+  for(i = 0; i < CACHE_DISK_PROBES; i++) {
+    s = disk_slot_at(c, (key->h1 + i) % c->nslots);
+    if( slot_valid(s) && key_equal(&s->key, key) ) {
+      blob = (char*) malloc(s->size);
+      memcpy(blob, (char*) (s + 1), s->size);
+      *size = s->size;
+      break;
+    }
+  }
+  flock(c->fd, LOCK_UN);
+
+  return blob;
+}
+
+static void disk_store(result_cache* c, cache_key* key, const char* blob, int size) {
+  disk_slot *s, *victim = 0;
+  int i;
+
+  //Results too big for a slot are kept only in memory
+  if( size > CACHE_SLOT_SIZE - (int) sizeof(disk_slot) )
+    return;
+
+  flock(c->fd, LOCK_EX);
+  for(i = 0; i < CACHE_DISK_PROBES; i++) {
+    s = disk_slot_at(c, (key->h1 + i) % c->nslots);
+    if( slot_valid(s) && key_equal(&s->key, key) ) {
+      flock(c->fd, LOCK_UN);
+      return;
+    }
+    if( !slot_valid(s) && !victim )
+      victim = s;
+  }
+
+  //If all the probed slots are full, we evict one of them, chosen with the second hash
+  if( !victim )
+    victim = disk_slot_at(c, (key->h1 + key->h2 % CACHE_DISK_PROBES) % c->nslots);
+
+  victim->size = 0;
+  memcpy((char*) (victim + 1), blob, size);
+  victim->key = *key;
+  victim->tag = CACHE_SLOT_TAG;
+  victim->size = size;
+  flock(c->fd, LOCK_UN);
+}
+
+result_cache* cache_create(int capacity, const char* diskfile) {
+  result_cache* c = (result_cache*) calloc(1, sizeof(result_cache));
+
+  c->capacity = capacity;
+  c->nbuckets = 2 * capacity + 1;
+  c->buckets = (cache_entry**) calloc(c->nbuckets, sizeof(cache_entry*));
+  c->fd = -1;
+
+  if( diskfile )
+    disk_open(c, diskfile);
+
+  return c;
+}
+
+int cache_lookup(result_cache* c, cache_key* key, eqlist** list, int* steps) {
+  cache_entry* e = memory_find(c, key);
+  char* blob;
+  int size;
+
+  if( e ) {
+    lru_unlink(c, e);
+    lru_push_front(c, e);
+    *list = deserialize_eqlist(e->blob, steps);
+    c->memory_hits++;
+    return 1;
+  }
+
+  if( c->fd >= 0 && (blob = disk_lookup(c, key, &size)) != 0 ) {
+    *list = deserialize_eqlist(blob, steps);
+    memory_insert(c, key, blob, size);
+    free(blob);
+    c->disk_hits++;
+    return 1;
+  }
+
+  c->misses++;
+  return 0;
+}
+
+void cache_store(result_cache* c, cache_key* key, eqlist* list, int steps) {
+  int size;
+  char* blob = serialize_eqlist(list, steps, &size);
+
+  memory_insert(c, key, blob, size);
+  if( c->fd >= 0 )
+    disk_store(c, key, blob, size);
+
+  free(blob);
+}
+
+void cache_print_stats(result_cache* c, FILE* f) {
+  int total = c->memory_hits + c->disk_hits + c->misses;
+
+  fprintf(f,"Cache lookups: %d, memory hits: %d, disk hits: %d, hit rate: %.1lf%%\n",
+	  total, c->memory_hits, c->disk_hits,
+	  total ? 100.0 * (c->memory_hits + c->disk_hits) / total : 0.0);
+}
+
+void cache_free(result_cache* c) {
+  while( c->nentries > 0 )
+    memory_evict(c);
+  free(c->buckets);
+
+  if( c->map )
+    munmap(c->map, c->mapsize);
+  if( c->fd >= 0 )
+    close(c->fd);
+
+  free(c);
+}
@@ -0,0 +1,72 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "equilibria.h"
+
+/*
+  Result cache. Games are identified by a 128 bit hash of their dimensions, payoffs and of the
+  options of the solver: we don't keep the payoffs, so a hit costs only the hashing of the game.
+*/
+
+typedef struct cache_key_ {
+  unsigned long long h1;
+  unsigned long long h2;
+} cache_key;
+
+typedef struct cache_entry_ {
+  cache_key key;
+  char* blob;        //Serialized equilibria and pivot count
+  int size;
+  struct cache_entry_* hnext;  //Next entry in the same hash bucket
+  struct cache_entry_* prev;   //LRU list, most recently used first
+  struct cache_entry_* next;
+} cache_entry;
+
+typedef struct result_cache_ {
+  //In-memory LRU tier
+  cache_entry** buckets;
+  int nbuckets;
+  int nentries;
+  int capacity;
+  cache_entry* lru_head;
+  cache_entry* lru_tail;
+
+  //Optional on-disk tier, memory mapped and shared by all processes using the same file
+  int fd;
+  char* map;
+  size_t mapsize;
+  int nslots;
+
+  //Statistics
+  int memory_hits;
+  int disk_hits;
+  int misses;
+} result_cache;
+
+#define CACHE_MEMORY_ENTRIES 1024
+#define CACHE_DISK_SLOTS 4096
+#define CACHE_SLOT_SIZE 4096
+#define CACHE_DISK_PROBES 8
+
+//Creates a cache with the given in-memory capacity. If diskfile is not NULL, the on-disk tier is opened (or created)
+result_cache* cache_create(int capacity, const char* diskfile);
+
+//Computes the key of a game. all is 1 when looking for all equilibria, in that case pivot is ignored
+void cache_make_key(cache_key* key, double** bimatrix, int dim1, int dim2, int pivot, int all, int engine);
+
+//Looks for a result. On a hit it returns 1, and a newly allocated copy of the equilibria in *list
+int cache_lookup(result_cache* cache, cache_key* key, eqlist** list, int* steps);
+
+//Stores a result in both tiers
+void cache_store(result_cache* cache, cache_key* key, eqlist* list, int steps);
+
+//Serialized form of a list of equilibria and of its pivot count, used by both tiers (and by the checkpoints)
+char* serialize_eqlist(eqlist* list, int steps, int* size);
+eqlist* deserialize_eqlist(const char* blob, int* steps);
+
+//Prints the hit rates
+void cache_print_stats(result_cache* cache, FILE* f);
+
+void cache_free(result_cache* cache);
+
+#endif
@@ -0,0 +1,324 @@
+#include <signal.h>
+#include <unistd.h>
+#include "checkpoint.h"
+
+static volatile sig_atomic_t ckpt_interrupted = 0;
+
+static void ckpt_signal(int sig) {
+  (void) sig;
+  ckpt_interrupted = 1;
+}
+
+static double ckpt_clock(void) {
+  struct timeval t;
+  gettimeofday(&t, NULL);
+  return t.tv_sec + t.tv_usec / 1e6;
+}
+
+static void ckpt_basis(double*** tableaus, int dim1, int dim2, int* basis) {
+  int i;
+
+  for(i = 0; i < dim1; i++)
+    basis[i] = (int) tableaus[0][i][0];
+  for(i = 0; i < dim2; i++)
+    basis[dim1 + i] = (int) tableaus[1][i][0];
+}
+
+static ckpt_frame* ckpt_push(ckpt_frame* stack, int* depth, int* cap, int taboo, int n) {
+  if( *depth == *cap ) {
+    *cap = *cap ? 2 * *cap : 16;
+    stack = (ckpt_frame*) realloc(stack, *cap * sizeof(ckpt_frame));
+  }
+  stack[*depth].taboo = taboo;
+  stack[*depth].pivot = 1;
+  stack[*depth].node = 0;
+  stack[*depth].basis = (int*) malloc(n * sizeof(int));
+  (*depth)++;
+  return stack;
+}
+
+//Paths known from an equilibrium: a flag, and the paths if there are
+static void ckpt_write_paths(FILE* f, lh_path* paths, int n) {
+  int known = paths != 0;
+
+  fwrite(&known, sizeof(int), 1, f);
+  if( known )
+    fwrite(paths, sizeof(lh_path), n + 1, f);
+}
+
+static int ckpt_read_paths(FILE* f, lh_path** paths, int n) {
+  int known;
+
+  if( fread(&known, sizeof(int), 1, f) != 1 )
+    return 0;
+  if( !known )
+    return 1;
+  *paths = (lh_path*) malloc((n + 1) * sizeof(lh_path));
+  return fread(*paths, sizeof(lh_path), n + 1, f) == (size_t) (n + 1);
+}
+
+/*
+  File layout: magic, dimensions, key of the game, depth of the stack, size and blob of the equilibria
+  found (as serialized by the cache), the frames (with the id of their equilibrium), the counters of the
+  memoization, the ids and the paths of the equilibria in the order of the list, the paths of the
+  artificial equilibrium, and the arena of the tableaus. The file is written under another name and
+  renamed, so an interruption while writing leaves the previous checkpoint.
+*/
+
+static void ckpt_write(checkpoint* ck, double*** tableaus, int dim1, int dim2, eqlist* lista, int steps, lh_memo* memo, ckpt_frame* stack, int depth) {
+  char* tmp = (char*) malloc(strlen(ck->file) + 5);
+  double start = ckpt_clock();
+  int size, k, ok, id;
+  char* blob;
+  eqlist* l;
+  FILE* f;
+
+  sprintf(tmp, "%s.tmp", ck->file);
+  f = fopen(tmp, "wb");
+  if( !f ) {
+    fprintf(stderr,"Cannot write the checkpoint %s\n",tmp);
+    exit(1);
+  }
+
+  blob = serialize_eqlist(lista, steps, &size);
+  fwrite(CHECKPOINT_MAGIC, 1, CHECKPOINT_MAGIC_LEN, f);
+  fwrite(&dim1, sizeof(int), 1, f);
+  fwrite(&dim2, sizeof(int), 1, f);
+  fwrite(&ck->key, sizeof(cache_key), 1, f);
+  fwrite(&depth, sizeof(int), 1, f);
+  fwrite(&size, sizeof(int), 1, f);
+  fwrite(blob, 1, size, f);
+  for(k = 0; k < depth; k++) {
+    fwrite(&stack[k].taboo, sizeof(int), 1, f);
+    fwrite(&stack[k].pivot, sizeof(int), 1, f);
+    fwrite(stack[k].basis, sizeof(int), dim1 + dim2, f);
+    id = stack[k].node ? stack[k].node->id : 0;
+    fwrite(&id, sizeof(int), 1, f);
+  }
+  fwrite(&memo->count, sizeof(int), 1, f);
+  fwrite(&memo->skipped, sizeof(int), 1, f);
+  fwrite(&memo->avoided, sizeof(long), 1, f);
+  fwrite(&memo->degenerate, sizeof(int), 1, f);
+  for(l = lista; l != 0; l = l->next) {
+    fwrite(&l->id, sizeof(int), 1, f);
+    ckpt_write_paths(f, l->paths, dim1 + dim2);
+  }
+  ckpt_write_paths(f, memo->artificial, dim1 + dim2);
+  fwrite(tableaus[0][0], sizeof(double), (long) (dim1 + dim2) * (2 + dim1 + dim2), f);
+  free(blob);
+
+  ok = fflush(f) == 0 && fsync(fileno(f)) == 0;
+  ok = fclose(f) == 0 && ok;
+  if( !ok || rename(tmp, ck->file) != 0 ) {
+    fprintf(stderr,"Cannot write the checkpoint %s\n",ck->file);
+    exit(1);
+  }
+  free(tmp);
+
+  ck->written++;
+  ck->write_time += ckpt_clock() - start;
+}
+
+static int ckpt_read_all(FILE* f, void* data, long size) {
+  return fread(data, 1, size, f) == (size_t) size;
+}
+
+//Loads the checkpoint, if there is one. Returns 0 if there is no checkpoint to resume
+static int ckpt_read(checkpoint* ck, double*** tableaus, int dim1, int dim2, eqlist** lista, int* steps, lh_memo* memo, ckpt_frame** stack, int* depth, int* cap) {
+  char magic[CHECKPOINT_MAGIC_LEN];
+  int dims[2], n = dim1 + dim2, size, k, ok, id;
+  eqlist** nodes;
+  cache_key key;
+  char* blob;
+  eqlist* l;
+  FILE* f;
+
+  f = fopen(ck->file, "rb");
+  if( !f )
+    return 0;
+
+  ok = ckpt_read_all(f, magic, CHECKPOINT_MAGIC_LEN) && memcmp(magic, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_LEN) == 0 &&
+    ckpt_read_all(f, dims, sizeof(dims)) && ckpt_read_all(f, &key, sizeof(key)) &&
+    ckpt_read_all(f, depth, sizeof(int)) && ckpt_read_all(f, &size, sizeof(int)) && *depth >= 0 && size > 0;
+  if( !ok ) {
+    fprintf(stderr,"Checkpoint %s corrupted\n",ck->file);
+    exit(1);
+  }
+  if( dims[0] != dim1 || dims[1] != dim2 || key.h1 != ck->key.h1 || key.h2 != ck->key.h2 ) {
+    fprintf(stderr,"The checkpoint %s belongs to another game\n",ck->file);
+    exit(1);
+  }
+
+  blob = (char*) malloc(size);
+  if( !ckpt_read_all(f, blob, size) ) {
+    fprintf(stderr,"Checkpoint %s truncated\n",ck->file);
+    exit(1);
+  }
+  *lista = deserialize_eqlist(blob, steps);
+  free(blob);
+
+  *cap = 0;
+  for(k = 0, size = *depth, *depth = 0; k < size; k++) {
+    *stack = ckpt_push(*stack, depth, cap, 0, n);
+    if( !ckpt_read_all(f, &(*stack)[k].taboo, sizeof(int)) || !ckpt_read_all(f, &(*stack)[k].pivot, sizeof(int)) ||
+	!ckpt_read_all(f, (*stack)[k].basis, n * sizeof(int)) || !ckpt_read_all(f, &id, sizeof(int)) ) {
+      fprintf(stderr,"Checkpoint %s truncated\n",ck->file);
+      exit(1);
+    }
+    //The ids are resolved to nodes once the list is numbered again
+    (*stack)[k].node = (eqlist*) (long) id;
+  }
+
+  ok = ckpt_read_all(f, &memo->count, sizeof(int)) && ckpt_read_all(f, &memo->skipped, sizeof(int)) &&
+    ckpt_read_all(f, &memo->avoided, sizeof(long)) && ckpt_read_all(f, &memo->degenerate, sizeof(int)) && memo->count >= 0;
+  nodes = (eqlist**) calloc(ok ? memo->count + 1 : 1, sizeof(eqlist*));
+  for(l = *lista; ok && l != 0; l = l->next) {
+    ok = ckpt_read_all(f, &l->id, sizeof(int)) && l->id > 0 && l->id <= memo->count && ckpt_read_paths(f, &l->paths, n);
+    if( ok )
+      nodes[l->id] = l;
+  }
+  ok = ok && ckpt_read_paths(f, &memo->artificial, n);
+  for(k = 0; ok && k < *depth; k++) {
+    id = (int) (long) (*stack)[k].node;
+    ok = id >= 0 && id <= memo->count && (id == 0) == (k == 0) && (id == 0 || nodes[id] != 0);
+    if( ok )
+      (*stack)[k].node = nodes[id];
+  }
+  free(nodes);
+
+  if( !ok || !ckpt_read_all(f, tableaus[0][0], (long) n * (n + 2) * sizeof(double)) ) {
+    fprintf(stderr,"Checkpoint %s truncated\n",ck->file);
+    exit(1);
+  }
+
+  fclose(f);
+  return 1;
+}
+
+/*
+  The loop below is all_lemke_gen with its recursion unrolled: a frame is pushed where all_lemke_gen
+  calls itself on a new equilibrium, and popped where the call returns, and then the tableaus are
+  restored to the equilibrium below by pivoting again on the same label. The pivots, and so the pivot
+  count and the list of equilibria, are the same of all_lemke_gen.
+*/
+
+eqlist* all_lemke_checkpointed(double*** tableaus, double** bimatrix, int dim1, int dim2, int* steps, lh_memo* memo, int debug, checkpoint* ck) {
+  ckpt_frame* stack = 0;
+  eqlist* lista = 0;
+  eqlist* to;
+  equilibrium* eq;
+  lh_path* paths;
+  int n = dim1 + dim2, depth = 0, cap = 0, npassi, found, taboo, degenerate;
+  int* basis = (int*) malloc(n * sizeof(int));
+  double start = ckpt_clock(), last, interval;
+  void (*oldint)(int);
+  void (*oldterm)(int);
+
+  if( ck->resume && ckpt_read(ck,tableaus,dim1,dim2,&lista,steps,memo,&stack,&depth,&cap) ) {
+    ckpt_basis(tableaus,dim1,dim2,basis);
+    if( depth > 0 && memcmp(basis, stack[depth - 1].basis, n * sizeof(int)) != 0 ) {
+      fprintf(stderr,"Checkpoint %s corrupted\n",ck->file);
+      exit(1);
+    }
+    fprintf(stderr,"Resuming from %s: %d pivoting steps done, at depth %d\n",ck->file,*steps,depth);
+  }
+  else {
+    stack = ckpt_push(stack,&depth,&cap,-1,n);
+    ckpt_basis(tableaus,dim1,dim2,stack[0].basis);
+  }
+
+  ckpt_interrupted = 0;
+  oldint = signal(SIGINT, ckpt_signal);
+  oldterm = signal(SIGTERM, ckpt_signal);
+  last = ckpt_clock();
+
+  while( depth > 0 ) {
+    /*
+      Checkpoints are written between two Lemke-Howson paths, when the tableaus are at the equilibrium
+      on top of the stack. If writing the last one took long, the next one waits longer.
+    */
+    interval = ck->write_time / (ck->written ? ck->written : 1) / CHECKPOINT_MAX_OVERHEAD;
+    interval = interval > ck->interval ? interval : ck->interval;
+    if( ckpt_interrupted || ckpt_clock() - last >= interval ) {
+      ckpt_write(ck,tableaus,dim1,dim2,lista,*steps,memo,stack,depth);
+      last = ckpt_clock();
+      if( ckpt_interrupted ) {
+	fprintf(stderr,"Interrupted: the enumeration can be resumed from %s\n",ck->file);
+	exit(CHECKPOINT_INTERRUPTED);
+      }
+    }
+
+    ckpt_frame* f = &stack[depth - 1];
+    if( f->pivot == f->taboo )
+      f->pivot++;
+
+    if( f->pivot <= n ) {
+      paths = memo_paths(memo,f->node);
+      if( !memo->degenerate && paths[f->pivot].end >= 0 ) {
+	memo->skipped++;
+	memo->avoided += 2L * paths[f->pivot].steps;
+	f->pivot++;
+	continue;
+      }
+    }
+
+    if( f->pivot > n ) {
+      free(f->basis);
+      depth--;
+      if( depth > 0 ) {
+	f = &stack[depth - 1];
+	free_equilibrium(lemke_howson_gen(tableaus,bimatrix,dim1,dim2,f->pivot,&npassi,0,debug));
+	*steps += npassi;
+	f->pivot++;
+      }
+      continue;
+    }
+
+    //As in all_lemke_gen, the first tie in a ratio test turns the memoization off
+    eq = lemke_howson_gen(tableaus,bimatrix,dim1,dim2,f->pivot,&npassi,&degenerate,debug);
+    *steps += npassi;
+    memo->degenerate |= degenerate;
+    if( degenerate == 2 ) {
+      fprintf(stderr,"The Lemke-Howson path with label %d cycles or has no end: the game is degenerate\n",f->pivot);
+      exit(1);
+    }
+
+    if( !is_artificial(eq) ) {
+      to = find_add_equilibrium(&lista,eq,&found);
+      if( !found )
+	to->id = ++memo->count;
+      if( !memo->degenerate )
+	memo_record(memo,f->node,to,f->pivot,npassi);
+      if( !found ) {
+	taboo = f->pivot;
+	stack = ckpt_push(stack,&depth,&cap,taboo,n);
+	stack[depth - 1].node = to;
+	ckpt_basis(tableaus,dim1,dim2,stack[depth - 1].basis);
+	continue;
+      }
+    }
+    else if( !memo->degenerate )
+      memo_record(memo,f->node,0,f->pivot,npassi);
+    free_equilibrium(eq);
+
+    free_equilibrium(lemke_howson_gen(tableaus,bimatrix,dim1,dim2,f->pivot,&npassi,0,debug));
+    *steps += npassi;
+    f->pivot++;
+  }
+
+  //The last checkpoint holds only the result: resuming from it ends immediately
+  ckpt_write(ck,tableaus,dim1,dim2,lista,*steps,memo,stack,0);
+
+  signal(SIGINT, oldint);
+  signal(SIGTERM, oldterm);
+  ck->run_time = ckpt_clock() - start;
+
+  free(stack);
+  free(basis);
+  return lista;
+}
+
+void checkpoint_print_stats(checkpoint* ck, FILE* f) {
+  fprintf(f,"%d checkpoints written to %s in %.3lf seconds (%.2lf%% of %.3lf seconds)\n",ck->written,ck->file,ck->write_time,
+	  ck->run_time > 0.0 ? 100.0 * ck->write_time / ck->run_time : 0.0,ck->run_time);
+}
@@ -0,0 +1,58 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "algorithm.h"
+#include "cache.h"
+
+/*
+  Checkpoints of the enumeration of all equilibria. all_lemke_gen keeps its state in the recursion;
+  here the same search is done with an explicit stack of frames, one for each equilibrium on the path
+  from the artificial equilibrium to the current one, with the next label to pivot on and its basis.
+  A checkpoint is that stack, the equilibria found so far with the endpoints of the paths walked from
+  them, and the tableaus at the equilibrium on top of the stack.
+
+  The tableaus are saved as they are, and not rebuilt from the bases: the pivots that bring them back
+  to an equilibrium after a Lemke-Howson path restore its basis, but not the last bits of its numbers,
+  so only the saved tableaus let a resumed run find exactly the equilibria of an uninterrupted one.
+  The equilibria below the top of the stack are reached from there as all_lemke_gen does, by pivoting
+  back on the labels of the frames.
+*/
+
+#define CHECKPOINT_MAGIC "LHCKPT02"
+#define CHECKPOINT_MAGIC_LEN 8
+
+//Default number of seconds between two checkpoints
+#define CHECKPOINT_INTERVAL 60
+
+//The checkpoints are spaced so that writing them takes at most this fraction of the enumeration
+#define CHECKPOINT_MAX_OVERHEAD 0.01
+
+//Exit status of a run stopped by SIGINT or SIGTERM, after writing its checkpoint
+#define CHECKPOINT_INTERRUPTED 3
+
+typedef struct ckpt_frame_ {
+  int taboo;     //Label pivoted on to reach this equilibrium from the one below (-1 for the artificial equilibrium)
+  int pivot;     //Next label to pivot on
+  int* basis;    //Labels in basis of the rows of the two tableaus, at this equilibrium
+  eqlist* node;  //Node of the equilibrium in the list (NULL for the artificial equilibrium)
+} ckpt_frame;
+
+typedef struct checkpoint_ {
+  const char* file;
+  double interval;     //Seconds between two checkpoints
+  int resume;          //Continues from the checkpoint in file, if there is one
+  cache_key key;       //Identifies the game, so that a checkpoint is never resumed on another one
+
+  //Statistics
+  int written;
+  double write_time;
+  double run_time;
+} checkpoint;
+
+//Same as all_lemke_gen from the artificial equilibrium, with checkpoints written in ck->file. memo must be initialized
+eqlist* all_lemke_checkpointed(double*** tableaus, double** bimatrix, int dim1, int dim2, int* steps, lh_memo* memo, int debug, checkpoint* ck);
+
+//Prints the number of checkpoints written and their cost
+void checkpoint_print_stats(checkpoint* ck, FILE* f);
+
+#endif
@@ -0,0 +1,618 @@
+#include <unistd.h>
+#include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include "daemon.h"
+
+typedef struct daemon_conn_ {
+  int in, out;
+  char* buf;              //Bytes received and not consumed yet
+  long len, cap;
+  FILE* replies;          //Replies not sent yet
+  char* replybuf;
+  size_t replysize;
+  FILE* body;             //Body of the reply being built
+  char* bodybuf;
+  size_t bodysize;
+  daemon_workspace ws;
+  daemon_solver solver;
+  void* ctx;
+} daemon_conn;
+
+static double daemon_clock(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static int write_all(int fd, const char* data, long size) {
+  long n;
+
+  while( size > 0 ) {
+    n = write(fd, data, size);
+    if( n < 0 && errno == EINTR )
+      continue;
+    if( n <= 0 )
+      return -1;
+    data += n;
+    size -= n;
+  }
+  return 0;
+}
+
+double*** workspace_systems(daemon_workspace* ws, double** bimatrix, int dim1, int dim2) {
+  if( ws->tableaus && ws->dim1 == dim1 && ws->dim2 == dim2 ) {
+    load_systems(ws->tableaus, bimatrix, dim1, dim2);
+    return ws->tableaus;
+  }
+
+  if( ws->tableaus )
+    free_tableaus(ws->tableaus, ws->dim1, ws->dim2);
+  ws->tableaus = create_systems(bimatrix, dim1, dim2);
+  ws->dim1 = dim1;
+  ws->dim2 = dim2;
+  return ws->tableaus;
+}
+
+/*
+  The readers of bimatrix.c abort on a corrupted file, or ignore the payoffs they cannot read, which a
+  daemon cannot do: binary games are checked before handing them to their reader, and NFG games are
+  parsed here, the payoffs with strtod. A game whose body is not exactly the 2 * DIM1 * DIM2 numbers
+  announced by its header is rejected.
+*/
+
+//Reads the header, and sets *start to the offset of the payoffs
+static int nfg_dimensions(const char* data, long size, int* dims, long* start) {
+  char tmp[64];
+  long p = 0;
+  int n;
+
+  if( size < 7 || strncmp(data, "NFG 1 D", 7) != 0 )
+    return 0;
+
+  while( p < size && data[p] != '\n' )
+    p++;
+  for(n = 0; p < size && n < 2; p++)
+    n += data[p] == '\"';
+  if( n < 2 )
+    return 0;
+  for(n = 0; p < size && n < 2; p++)
+    n += data[p] == '{' || data[p] == '}';
+  if( n < 2 )
+    return 0;
+
+  n = size - p < (long) sizeof(tmp) - 1 ? size - p : (long) sizeof(tmp) - 1;
+  memcpy(tmp, data + p, n);
+  tmp[n] = 0;
+  if( sscanf(tmp, "%d %d", &dims[0], &dims[1]) != 2 )
+    return 0;
+  while( p < size && data[p] != '}' )
+    p++;
+  *start = p + 1;
+
+  //Each payoff takes at least a digit and a blank
+  return p < size && dims[0] > 0 && dims[1] > 0 && dims[0] <= DAEMON_MAX_DIM && dims[1] <= DAEMON_MAX_DIM && size >= 4L * dims[0] * dims[1];
+}
+
+//Same as gamut_import_bimatrix on the payoffs of the body, or NULL if they are not exactly 2 * dim1 * dim2 numbers
+static double** nfg_payoffs(const char* data, long size, int dim1, int dim2, double* min) {
+  char* text = (char*) malloc(size + 1);
+  double** bimatrix = alloc_bimatrix(dim1, dim2);
+  char *p = text, *end;
+  double n[2];
+  int i, j, k, ok = 1;
+
+  memcpy(text, data, size);
+  text[size] = 0;
+  *min = 1000000;
+
+  for(i = 0; i < dim2 && ok; i++) {
+    for(j = 0; j < dim1 && ok; j++) {
+      for(k = 0; k < 2 && ok; k++) {
+	n[k] = strtod(p, &end);
+	ok = end != p && (*end == 0 || isspace((unsigned char) *end));
+	p = end;
+      }
+      if( ok ) {
+	*min = *min < (n[0] < n[1] ? n[0] : n[1]) ? *min : (n[0] < n[1] ? n[0] : n[1]);
+	bimatrix[j][i] = n[0]; bimatrix[j+dim1][i] = n[1];
+      }
+    }
+  }
+  while( ok && isspace((unsigned char) *p) )
+    p++;
+  ok = ok && *p == 0;
+
+  free(text);
+  if( !ok ) {
+    free_bimatrix(bimatrix, dim1, dim2);
+    return 0;
+  }
+  return bimatrix;
+}
+
+static double** daemon_read_game(char* data, long size, double* min, int* dim1, int* dim2, const char** error) {
+  double** bimatrix;
+  int32_t bdims[2];
+  int dims[2];
+  long start;
+  FILE* f;
+  int binary = size >= BIMATRIX_MAGIC_LEN && memcmp(data, BIMATRIX_MAGIC, BIMATRIX_MAGIC_LEN) == 0;
+
+  if( binary ) {
+    if( size < BIMATRIX_MAGIC_LEN + (long) sizeof(bdims) ) {
+      *error = "Binary game truncated";
+      return 0;
+    }
+    memcpy(bdims, data + BIMATRIX_MAGIC_LEN, sizeof(bdims));
+    if( bdims[0] <= 0 || bdims[1] <= 0 || bdims[0] > DAEMON_MAX_DIM || bdims[1] > DAEMON_MAX_DIM ||
+	size != BIMATRIX_MAGIC_LEN + (long) sizeof(bdims) + 2L * bdims[0] * bdims[1] * (long) sizeof(double) ) {
+      *error = "Binary game corrupted";
+      return 0;
+    }
+  }
+  else if( !nfg_dimensions(data, size, dims, &start) ) {
+    *error = "The game must be a NFG file (NFG 1 D) or a binary game file";
+    return 0;
+  }
+  else {
+    bimatrix = nfg_payoffs(data + start, size - start, dims[0], dims[1], min);
+    if( !bimatrix )
+      *error = "The payoffs of the game must be 2 * DIM1 * DIM2 numbers";
+    *dim1 = dims[0];
+    *dim2 = dims[1];
+    return bimatrix;
+  }
+
+  f = fmemopen(data, size, "r");
+  if( !f ) {
+    *error = "Out of memory";
+    return 0;
+  }
+  bimatrix = binary_import_bimatrix(f, min, dim1, dim2);
+  fclose(f);
+
+  return bimatrix;
+}
+
+static void daemon_error(daemon_conn* c, unsigned long long id, const char* message) {
+  fprintf(c->replies, "ERR %llu %ld\n%s\n", id, (long) strlen(message) + 1, message);
+}
+
+//Handles the request at the start of data. Returns its length, 0 if it is not complete yet, and -1 if the connection must be closed
+static long daemon_request(daemon_conn* c, char* data, long len) {
+  char header[DAEMON_MAX_HEADER];
+  char* nl = (char*) memchr(data, '\n', len);
+  unsigned long long id;
+  const char* error = 0;
+  double** bimatrix;
+  double min, start;
+  long hlen, size, bodylen;
+  int pivot, dim1, dim2, steps = 0, n;
+
+  if( !nl ) {
+    if( len < DAEMON_MAX_HEADER )
+      return 0;
+    daemon_error(c, 0, "Header too long");
+    return -1;
+  }
+  hlen = nl - data + 1;
+  if( hlen > DAEMON_MAX_HEADER ) {
+    daemon_error(c, 0, "Header too long");
+    return -1;
+  }
+  memcpy(header, data, hlen - 1);
+  header[hlen - 1] = 0;
+
+  if( strcmp(header, "QUIT") == 0 )
+    return -1;
+  if( sscanf(header, "SOLVE %llu %d %ld", &id, &pivot, &size) != 3 || size < 0 || size > DAEMON_MAX_GAME ) {
+    daemon_error(c, 0, "Malformed request");
+    return -1;
+  }
+  if( len < hlen + size )
+    return 0;
+
+  start = daemon_clock();
+  bimatrix = daemon_read_game(data + hlen, size, &min, &dim1, &dim2, &error);
+  if( !bimatrix ) {
+    daemon_error(c, id, error);
+    return hlen + size;
+  }
+
+  fseek(c->body, 0, SEEK_SET);
+  n = c->solver(c->ctx, &c->ws, bimatrix, dim1, dim2, min, pivot, c->body, &steps);
+  free_bimatrix(bimatrix, dim1, dim2);
+  fflush(c->body);
+  bodylen = ftell(c->body);
+
+  if( n < 0 )
+    fprintf(c->replies, "ERR %llu %ld\n", id, bodylen);
+  else
+    fprintf(c->replies, "OK %llu %d %d %.0lf %ld\n", id, steps, n, (daemon_clock() - start) * 1e6, bodylen);
+  fwrite(c->bodybuf, 1, bodylen, c->replies);
+
+  return hlen + size;
+}
+
+static int daemon_flush(daemon_conn* c) {
+  long n;
+
+  fflush(c->replies);
+  n = ftell(c->replies);
+  fseek(c->replies, 0, SEEK_SET);
+  return n > 0 ? write_all(c->out, c->replybuf, n) : 0;
+}
+
+/*
+  Requests are solved as soon as they are complete in the buffer, and their replies accumulated: they
+  are written only when the buffer holds no other complete request, so a client sending many requests
+  at once gets its replies with a few writes.
+*/
+
+static void daemon_connection(daemon_conn* c) {
+  long done, n, r;
+
+  for(;;) {
+    for(done = 0; (n = daemon_request(c, c->buf + done, c->len - done)) > 0; done += n);
+    memmove(c->buf, c->buf + done, c->len - done);
+    c->len -= done;
+    if( daemon_flush(c) < 0 || n < 0 )
+      break;
+
+    if( c->len == c->cap ) {
+      c->cap *= 2;
+      c->buf = (char*) realloc(c->buf, c->cap);
+    }
+    r = read(c->in, c->buf + c->len, c->cap - c->len);
+    if( r < 0 && errno == EINTR )
+      continue;
+    if( r <= 0 )
+      break;
+    c->len += r;
+  }
+}
+
+static daemon_conn* daemon_conn_create(int in, int out, daemon_solver solver, void* ctx, const char* cachefile) {
+  daemon_conn* c = (daemon_conn*) calloc(1, sizeof(daemon_conn));
+
+  c->in = in;
+  c->out = out;
+  c->cap = DAEMON_BUFFER;
+  c->buf = (char*) malloc(c->cap);
+  c->replies = open_memstream(&c->replybuf, &c->replysize);
+  c->body = open_memstream(&c->bodybuf, &c->bodysize);
+  c->ws.cache = cache_create(CACHE_MEMORY_ENTRIES, cachefile);
+  c->solver = solver;
+  c->ctx = ctx;
+
+  return c;
+}
+
+static void daemon_conn_free(daemon_conn* c) {
+  fclose(c->replies);
+  fclose(c->body);
+  free(c->replybuf);
+  free(c->bodybuf);
+  free(c->buf);
+  if( c->ws.tableaus )
+    free_tableaus(c->ws.tableaus, c->ws.dim1, c->ws.dim2);
+  cache_free(c->ws.cache);
+  free(c);
+}
+
+static void* daemon_thread(void* arg) {
+  daemon_conn* c = (daemon_conn*) arg;
+
+  daemon_connection(c);
+  close(c->in);
+  daemon_conn_free(c);
+  return 0;
+}
+
+static int daemon_address(const char* path, struct sockaddr_un* addr) {
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  if( strlen(path) >= sizeof(addr->sun_path) ) {
+    fprintf(stderr,"Socket path too long: %s\n",path);
+    return -1;
+  }
+  strcpy(addr->sun_path, path);
+  return 0;
+}
+
+static int daemon_connect(const char* path) {
+  struct sockaddr_un addr;
+  int fd;
+
+  if( daemon_address(path, &addr) < 0 )
+    return -1;
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if( fd < 0 || connect(fd, (struct sockaddr*) &addr, sizeof(addr)) < 0 ) {
+    if( fd >= 0 )
+      close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+void daemon_serve(const char* path, daemon_solver solver, void* ctx, const char* cachefile) {
+  struct sockaddr_un addr;
+  struct stat st;
+  pthread_attr_t attr;
+  pthread_t thread;
+  daemon_conn* c;
+  int sock, fd;
+
+  //A client that goes away must not kill the daemon while we write its replies
+  signal(SIGPIPE, SIG_IGN);
+
+  if( strcmp(path, "-") == 0 ) {
+    c = daemon_conn_create(0, 1, solver, ctx, cachefile);
+    daemon_connection(c);
+    daemon_conn_free(c);
+    return;
+  }
+
+  if( daemon_address(path, &addr) < 0 )
+    exit(1);
+
+  //The socket left by a daemon that was killed is removed, but not the one of a daemon still running
+  if( stat(path, &st) == 0 && S_ISSOCK(st.st_mode) ) {
+    fd = daemon_connect(path);
+    if( fd >= 0 ) {
+      close(fd);
+      fprintf(stderr,"A daemon is already listening on %s\n",path);
+      exit(1);
+    }
+    unlink(path);
+  }
+
+  sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  if( sock < 0 || bind(sock, (struct sockaddr*) &addr, sizeof(addr)) < 0 || listen(sock, SOMAXCONN) < 0 ) {
+    fprintf(stderr,"Cannot listen on %s: %s\n",path,strerror(errno));
+    exit(1);
+  }
+  fprintf(stderr,"Listening on %s\n",path);
+
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+  for(;;) {
+    fd = accept(sock, 0, 0);
+    if( fd < 0 ) {
+      if( errno == EINTR || errno == ECONNABORTED )
+	continue;
+      fprintf(stderr,"accept: %s\n",strerror(errno));
+      break;
+    }
+    c = daemon_conn_create(fd, fd, solver, ctx, cachefile);
+    if( pthread_create(&thread, &attr, daemon_thread, c) != 0 ) {
+      close(fd);
+      daemon_conn_free(c);
+    }
+  }
+
+  pthread_attr_destroy(&attr);
+  close(sock);
+}
+
+/*
+  Client and load generator. Each connection has a thread, which sends the requests k, k + connections,
+  k + 2 * connections, ... keeping at most depth of them in flight. The replies come back in order, so
+  the latency of a request is measured from its sending to the reading of the next reply.
+*/
+
+typedef struct client_conn_ {
+  const char* path;
+  daemon_load* load;
+  char* game;              //The game file, when the same game is sent in every request
+  long gamesize;
+  int k, n;                //First request of the connection, and number of its requests
+  double* latency;
+  double server;           //Total time spent by the daemon on the requests
+  int failed;
+} client_conn;
+
+static pthread_mutex_t client_print = PTHREAD_MUTEX_INITIALIZER;
+
+//Writes request number k (global numbering) to fd
+static int client_send(client_conn* c, int fd, int k) {
+  daemon_load* load = c->load;
+  char header[DAEMON_MAX_HEADER];
+  char* data = c->game;
+  size_t size = c->gamesize;
+  FILE* f;
+  double** bimatrix;
+  double min;
+  int hlen, err;
+
+  if( !data ) {
+    bimatrix = get_random_bimatrix_seeded(load->dim1, load->dim2, load->seed, load->first + k, 1, &min);
+    f = open_memstream(&data, &size);
+    binary_export_bimatrix(bimatrix, load->dim1, load->dim2, f);
+    fclose(f);
+    free_bimatrix(bimatrix, load->dim1, load->dim2);
+  }
+
+  hlen = snprintf(header, sizeof(header), "SOLVE %d %d %ld\n", k, load->pivot, (long) size);
+  err = write_all(fd, header, hlen) < 0 || write_all(fd, data, size) < 0;
+
+  if( !c->game )
+    free(data);
+  return err ? -1 : 0;
+}
+
+//Reads the next reply. Returns -1 if the connection was closed
+static int client_receive(client_conn* c, FILE* in) {
+  char header[DAEMON_MAX_HEADER];
+  unsigned long long id;
+  int steps, n;
+  double usec;
+  long size;
+  char* body;
+
+  if( !fgets(header, sizeof(header), in) )
+    return -1;
+
+  if( sscanf(header, "OK %llu %d %d %lf %ld", &id, &steps, &n, &usec, &size) == 5 ) {
+    c->server += usec;
+  }
+  else if( sscanf(header, "ERR %llu %ld", &id, &size) == 2 ) {
+    c->failed++;
+  }
+  else
+    return -1;
+
+  body = (char*) malloc(size + 1);
+  if( fread(body, 1, size, in) != (size_t) size ) {
+    free(body);
+    return -1;
+  }
+  body[size] = 0;
+
+  pthread_mutex_lock(&client_print);
+  if( header[0] == 'E' )
+    fprintf(stderr,"Request %llu failed: %s",id,body);
+  else if( c->load->print ) {
+    fputs(body, stdout);
+    fprintf(stdout,"Number of complementary pivoting steps performed by the algorithm: %d\n",steps);
+  }
+  pthread_mutex_unlock(&client_print);
+
+  free(body);
+  return 0;
+}
+
+static void* client_thread(void* arg) {
+  client_conn* c = (client_conn*) arg;
+  int depth = c->load->depth > 0 ? c->load->depth : 1;
+  int connections = c->load->connections;
+  double* sent = (double*) malloc((c->n > 0 ? c->n : 1) * sizeof(double));
+  int fd, nsent = 0, nreceived = 0;
+  FILE* in;
+
+  fd = daemon_connect(c->path);
+  if( fd < 0 ) {
+    fprintf(stderr,"Cannot connect to %s: %s\n",c->path,strerror(errno));
+    c->failed = c->n;
+    free(sent);
+    return 0;
+  }
+  in = fdopen(dup(fd), "r");
+
+  while( nreceived < c->n ) {
+    while( nsent < c->n && nsent - nreceived < depth ) {
+      if( client_send(c, fd, c->k + nsent * connections) < 0 )
+	break;
+      sent[nsent++] = daemon_clock();
+    }
+    if( nreceived == nsent || client_receive(c, in) < 0 )
+      break;
+    c->latency[nreceived] = (daemon_clock() - sent[nreceived]) * 1e6;
+    nreceived++;
+  }
+  c->failed += c->n - nreceived;
+  c->n = nreceived;
+
+  write_all(fd, "QUIT\n", 5);
+  fclose(in);
+  close(fd);
+  free(sent);
+  return 0;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+  double x = *(const double*) a, y = *(const double*) b;
+  return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static double percentile(double* sorted, int n, double p) {
+  int k = (int) (p * n);
+  return sorted[k < n ? k : n - 1];
+}
+
+int daemon_client(const char* path, daemon_load* load) {
+  client_conn* conns;
+  pthread_t* threads;
+  double* latency;
+  double start, elapsed, server = 0.0, total = 0.0;
+  char* game = 0;
+  long gamesize = 0;
+  int connections, c, n = 0, failed = 0;
+  FILE* f;
+
+  if( load->gamefile ) {
+    f = fopen(load->gamefile, "r");
+    if( !f ) {
+      fprintf(stderr,"Cannot open %s\n",load->gamefile);
+      exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    gamesize = ftell(f);
+    rewind(f);
+    game = (char*) malloc(gamesize);
+    if( fread(game, 1, gamesize, f) != (size_t) gamesize ) {
+      fprintf(stderr,"Cannot read %s\n",load->gamefile);
+      exit(1);
+    }
+    fclose(f);
+  }
+
+  connections = load->connections > 0 ? load->connections : 1;
+  if( connections > load->count )
+    connections = load->count > 0 ? load->count : 1;
+  load->connections = connections;
+
+  conns = (client_conn*) calloc(connections, sizeof(client_conn));
+  threads = (pthread_t*) malloc(connections * sizeof(pthread_t));
+  latency = (double*) malloc((load->count > 0 ? load->count : 1) * sizeof(double));
+
+  start = daemon_clock();
+  for(c = 0; c < connections; c++) {
+    conns[c].path = path;
+    conns[c].load = load;
+    conns[c].game = game;
+    conns[c].gamesize = gamesize;
+    conns[c].k = c;
+    conns[c].n = (load->count - c + connections - 1) / connections;
+    conns[c].latency = latency + n;
+    n += conns[c].n;
+    pthread_create(&threads[c], 0, client_thread, &conns[c]);
+  }
+
+  //The latencies of the connections are compacted at the start of the array, and sorted together
+  for(c = 0, n = 0; c < connections; c++) {
+    pthread_join(threads[c], 0);
+    memmove(latency + n, conns[c].latency, conns[c].n * sizeof(double));
+    n += conns[c].n;
+    server += conns[c].server;
+    failed += conns[c].failed;
+  }
+  elapsed = daemon_clock() - start;
+
+  if( n > 0 ) {
+    qsort(latency, n, sizeof(double), compare_doubles);
+    for(c = 0; c < n; c++)
+      total += latency[c];
+    fprintf(stderr,"%d requests on %d connections (%d in flight on each) in %.3lf seconds: %.0lf requests/sec\n",
+	    n, connections, load->depth > 0 ? load->depth : 1, elapsed, elapsed > 0.0 ? n / elapsed : 0.0);
+    fprintf(stderr,"Latency (microseconds): mean %.1lf, p50 %.1lf, p90 %.1lf, p99 %.1lf, p99.9 %.1lf, max %.1lf\n",
+	    total / n, percentile(latency,n,0.5), percentile(latency,n,0.9), percentile(latency,n,0.99),
+	    percentile(latency,n,0.999), latency[n - 1]);
+    fprintf(stderr,"Time spent by the daemon on each request (microseconds): mean %.1lf\n", server / n);
+  }
+  if( failed )
+    fprintf(stderr,"%d requests failed\n",failed);
+
+  free(conns);
+  free(threads);
+  free(latency);
+  free(game);
+  return failed;
+}
@@ -0,0 +1,69 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include "bimatrix.h"
+#include "cache.h"
+
+/*
+  Solver daemon. It stays resident and solves the games sent over a Unix domain socket (or on stdin),
+  so the requests don't pay the start of a process and the allocations of a cold one. Requests and
+  replies are a text header line, followed by a body of the given number of bytes:
+
+    SOLVE <id> <pivot> <bytes>\n<game>    The game is a NFG file or a binary game file. Pivot 0 asks for all equilibria
+    QUIT\n                                Closes the connection
+
+    OK <id> <steps> <equilibria> <microseconds> <bytes>\n<equilibria, in the format of -G>
+    ERR <id> <bytes>\n<error message>
+
+  A client can send many requests without waiting for the replies (pipelining): they are solved in
+  order, and the replies are written back together when no other complete request is waiting. The
+  microseconds are the time the daemon spent on the request, from its parsing to its reply.
+*/
+
+#define DAEMON_MAX_HEADER 256
+#define DAEMON_MAX_GAME (1L << 30)
+#define DAEMON_MAX_DIM (1 << 16)
+#define DAEMON_BUFFER (1 << 16)
+
+//Working memory of a connection, kept from one request to the next
+typedef struct daemon_workspace_ {
+  double*** tableaus;   //Tableaus of the double engine, reused while the games keep the same size
+  int dim1, dim2;
+  result_cache* cache;  //Results of the connection (the on-disk tier, if any, is shared by all of them)
+} daemon_workspace;
+
+/*
+  Solves the game of a request, writing the equilibria on out, and their pivoting steps in *steps.
+  Returns the number of equilibria, or -1 after writing an error message on out.
+*/
+typedef int (*daemon_solver)(void* ctx, daemon_workspace* ws, double** bimatrix, int dim1, int dim2, double min, int pivot, FILE* out, int* steps);
+
+//Tableaus of the workspace loaded with the game (they are allocated again only when its size changes)
+double*** workspace_systems(daemon_workspace* ws, double** bimatrix, int dim1, int dim2);
+
+/*
+  Serves the requests on the Unix socket at path, with one thread and one workspace per connection, or
+  on stdin and stdout when path is "-". cachefile is the on-disk tier of the result caches, or NULL.
+*/
+void daemon_serve(const char* path, daemon_solver solver, void* ctx, const char* cachefile);
+
+//Requests sent by the client and load generator
+typedef struct daemon_load_ {
+  const char* gamefile;   //Game sent in every request, or NULL for the random games first, first+1, ... of seed
+  int dim1, dim2;
+  unsigned long long seed, first;
+  int pivot;              //0 for all equilibria
+  int count;              //Number of requests
+  int connections;        //Connections opened at the same time, each one with a thread
+  int depth;              //Requests in flight on each connection
+  int print;              //Prints the equilibria of the replies on stdout
+} daemon_load;
+
+/*
+  Sends the requests to the daemon listening at path, and reports on stderr the throughput and the
+  percentiles of the latency (from the sending of a request to the reading of its reply). Returns the
+  number of requests that failed.
+*/
+int daemon_client(const char* path, daemon_load* load);
+
+#endif
@@ -21,11 +21,21 @@
 */
 
 equilibrium* add_strategy(equilibrium *old, int label, double prob) {
+  return add_strategy_exact(old,label,prob,0);
+}
+
+/*
+  Same as add_strategy, but the strategy also carries its exact rational probability as a string
+  (the equilibrium takes ownership of it).
+*/
+
+equilibrium* add_strategy_exact(equilibrium *old, int label, double prob, char *exact) {
   equilibrium *i;
  
   equilibrium *neweq = malloc(sizeof(equilibrium));
   neweq->label = label;
   neweq->prob = prob;
+  neweq->exact = exact;
   neweq->next = 0;
   
   //In this case, we need to create a new equilibrium, so we simply return item we just created.
@@ -61,7 +71,10 @@ void print_equilibrium(equilibrium *eq, FILE *f) {
   fprintf(f,"\nStrategy\tProbability\n");
 
   while(eq!=0) {
-    fprintf(f,"%d\t\t%.7lf\n",eq->label,eq->prob);
+    if(eq->exact)
+      fprintf(f,"%d\t\t%s\n",eq->label,eq->exact);
+    else
+      fprintf(f,"%d\t\t%.7lf\n",eq->label,eq->prob);
     eq = eq->next;
   }
 
@@ -80,7 +93,10 @@ void print_equilibrium_gambit(equilibrium *eq, int dim1, int dim2, FILE *f) {
 
   for(i = 1; i <= (dim1+dim2); i++) {
     if( eq!=0 && eq->label == i) {
-      fprintf(f,",%-.8lf",eq->prob);
+      if(eq->exact)
+        fprintf(f,",%s",eq->exact);
+      else
+        fprintf(f,",%-.8lf",eq->prob);
       eq = eq->next;
     }
     else
@@ -139,6 +155,7 @@ void free_equilibrium(equilibrium* eq) {
     return;
 
   free_equilibrium(eq->next);
+  free(eq->exact);
   free(eq);
 }
 
@@ -151,48 +168,57 @@ void free_equilibrium(equilibrium* eq) {
 */
 
 eqlist* search_add_equilibrium(eqlist* list, equilibrium *eq, int* found) {
+  find_add_equilibrium(&list,eq,found);
+  return list;
+}
+
+eqlist* find_add_equilibrium(eqlist** list, equilibrium *eq, int* found) {
   
   eqlist* i;
   
   eqlist* newlist = malloc(sizeof(eqlist));
   newlist->next = 0;
   newlist->eq = eq;
+  newlist->id = 0;
+  newlist->paths = 0;
   
-  if ( list == 0 ) {
+  if ( *list == 0 ) {
     *found = 0;
+    *list = newlist;
     return newlist;
   }
   
-  if ( lex_comp(list->eq,eq) > 0 ) {
+  if ( lex_comp((*list)->eq,eq) > 0 ) {
     *found = 0;
-    newlist->next = list;
+    newlist->next = *list;
+    *list = newlist;
     return newlist;
   }
-  else if ( lex_comp(list->eq,eq) == 0 ) {
+  else if ( lex_comp((*list)->eq,eq) == 0 ) {
     *found = 1;
     free(newlist);
-    return list;
+    return *list;
   } 
   
-  for( i = list; ; i = i->next) {
+  for( i = *list; ; i = i->next) {
     
     if(i->next == 0) {
       *found = 0;
       i->next = newlist;
-      return list;
+      return newlist;
     }
     
     if ( lex_comp(i->next->eq,eq) == 0 ) {
       *found = 1;
       free(newlist);
-      return list;
+      return i->next;
     }
     
     if( lex_comp(i->next->eq,eq) > 0) {
       *found = 0;
       newlist->next = i->next;
       i->next = newlist;
-      return list;
+      return newlist;
     }
   }
 
@@ -230,5 +256,6 @@ void free_eqlist(eqlist* lista) {
   
   free_eqlist(lista->next);
   free_equilibrium(lista->eq);
+  free(lista->paths);
   free(lista);
 }
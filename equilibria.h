@@ -1,19 +1,32 @@
+#ifndef EQUILIBRIA_H
+#define EQUILIBRIA_H
+
 #include <stdio.h>
 #include <stdlib.h>
 
 typedef struct equilibrium_ {
   int label;
   double prob;
+  char* exact; //Exact rational probability, if computed by the exact engine (NULL otherwise)
   struct equilibrium_* next;
 } equilibrium;
 
+//Endpoint of the Lemke-Howson path leaving an equilibrium with a given label
+typedef struct lh_path_ {
+  int end;    //Id of the equilibrium at the other end (0 for the artificial equilibrium), -1 while unknown
+  int steps;  //Number of pivots along the path
+} lh_path;
+
 typedef struct eqlist_ {
   equilibrium* eq;
+  int id;              //Equilibria are numbered from 1 in the order all_lemke finds them (0 when not numbered)
+  lh_path* paths;      //Paths leaving the equilibrium, by label (NULL until all_lemke records one)
   struct eqlist_* next;
 } eqlist;
 
 //Adds a strategy to an existent equilibrium, or creates a new one
 equilibrium* add_strategy(equilibrium*,int,double);
+equilibrium* add_strategy_exact(equilibrium*,int,double,char*);
 
 //Print an equilibrium on FILE
 void print_equilibrium(equilibrium*,FILE*);
@@ -35,9 +48,14 @@ void free_equilibrium(equilibrium*);
 //it adds it, and puts 0 in found
 eqlist* search_add_equilibrium(eqlist*,equilibrium*,int *found);
 
+//Same as search_add_equilibrium, but it returns the node holding the equilibrium (the new one, or the one already in the list)
+eqlist* find_add_equilibrium(eqlist** list,equilibrium*,int *found);
+
 //Prints an equilibrium list on FILE
 void print_eqlist(eqlist*,FILE*);
 void print_eqlist_gambit(eqlist*,int,int,FILE*);
 
 //Frees the memory occupied by a list of equilibria
 void free_eqlist(eqlist*);
+
+#endif
@@ -0,0 +1,555 @@
+/*
+  Exact engine.
+
+  This is the same Lemke-Howson algorithm implemented in algorithm.c, but working on integer
+  tableaus with integer-preserving (Bareiss) pivoting, so that no threshold like eps is needed to
+  decide the sign of a coefficient, and the probabilities of the equilibrium are exact rationals.
+
+  Each tableau keeps a common denominator det: row i represents the equation
+      det * x_basis[i] = T[i][1] + sum_j T[i][j] * x_j
+  When we pivot on row r and column c, the new denominator is -T[r][c], and all other rows are
+  updated with
+      T[i][j] = ( -T[r][c] * T[i][j] + T[i][c] * T[r][j] ) / det
+  where the division is always exact. This keeps the coefficients as small as possible (they are
+  minors of the original tableau), so that for small games they almost always fit in 64 bits: we
+  compute each update in 128 bit arithmetic, and only when the result doesn't fit in a long long
+  we promote that single row to bignums.
+
+  Degenerate games are handled with the lexicographic minimum ratio test, so the engine never
+  cycles.
+*/
+
+#include <limits.h>
+#include "exact.h"
+
+#define LL_FITS(x) ((x) >= (__int128) LLONG_MIN && (x) <= (__int128) LLONG_MAX)
+
+/*
+  The exact engine can only work with integer payoffs. We also require them to be reasonably
+  small (less than 2^31 in absolute value), so that the initial tableau is well inside the 64 bit
+  fast path.
+*/
+
+int integer_bimatrix(double** bimatrix, int dim1, int dim2) {
+  int i, j;
+
+  for(i = 0; i < (2 * dim1); i++) {
+    for(j = 0; j < dim2; j++) {
+      if( bimatrix[i][j] != floor(bimatrix[i][j]) || fabs(bimatrix[i][j]) > 2147483647.0 )
+	return 0;
+    }
+  }
+
+  return 1;
+}
+
+static exact_tableau* exact_alloc_tableau(int nlines, int width) {
+  int i;
+
+  exact_tableau* t = (exact_tableau*) malloc(sizeof(exact_tableau));
+  t->nlines = nlines;
+  t->width = width;
+  t->basis = (int*) malloc(nlines * sizeof(int));
+  t->det = 1;
+  t->det_is_big = 0;
+  bn_init(&t->det_big);
+  t->rows = (exact_row*) malloc(nlines * sizeof(exact_row));
+  for(i = 0; i < nlines; i++) {
+    t->rows[i].v = (long long*) calloc(width, sizeof(long long));
+    t->rows[i].big = 0;
+  }
+  t->scratch = (long long*) calloc(width, sizeof(long long));
+
+  return t;
+}
+
+/*
+  Creates the tableaus following exactly the same layout of create_systems, so that get_tableau
+  and get_column can be used on them as well.
+*/
+
+exact_tableau** exact_create_systems(double** bimatrix, int dim1, int dim2) {
+  int i, j;
+
+  exact_tableau** tableaus = (exact_tableau**) malloc(2 * sizeof(exact_tableau*));
+  tableaus[0] = exact_alloc_tableau(dim1, 2 + dim1 + dim2);
+  tableaus[1] = exact_alloc_tableau(dim2, 2 + dim1 + dim2);
+
+  for (i = 0; i < dim1; i++) {
+    tableaus[0]->basis[i] = - i - 1;
+    tableaus[0]->rows[i].v[1] = 1;
+    for (j = (2 + dim1); j < (dim1 + dim2 + 2); j++)
+      tableaus[0]->rows[i].v[j] = - (long long) bimatrix[i][j - 2 - dim1];
+  }
+  for (i = 0; i < dim2; i++) {
+    tableaus[1]->basis[i] = - i - dim1 - 1;
+    tableaus[1]->rows[i].v[1] = 1;
+    for (j = (2 + dim2); j < (dim1 + dim2 + 2); j++)
+      tableaus[1]->rows[i].v[j] = - (long long) bimatrix[dim1 + (j - 2 - dim2)][i];
+  }
+
+  return tableaus;
+}
+
+/*
+  Accessors: they hide whether a row (or the denominator) is stored in 64 bits or as bignums.
+*/
+
+static void exact_entry(exact_tableau* t, int i, int j, bignum* out) {
+  if( t->rows[i].big )
+    bn_copy(out, &t->rows[i].big[j]);
+  else
+    bn_set_ll(out, t->rows[i].v[j]);
+}
+
+static int exact_entry_sign(exact_tableau* t, int i, int j) {
+  if( t->rows[i].big )
+    return bn_sign(&t->rows[i].big[j]);
+
+  return t->rows[i].v[j] > 0 ? 1 : (t->rows[i].v[j] < 0 ? -1 : 0);
+}
+
+static void exact_det(exact_tableau* t, bignum* out) {
+  if( t->det_is_big )
+    bn_copy(out, &t->det_big);
+  else
+    bn_set_ll(out, t->det);
+}
+
+static void exact_promote_row(exact_tableau* t, int i) {
+  int j;
+  exact_row* row = &t->rows[i];
+
+  if( row->big )
+    return;
+
+  row->big = (bignum*) malloc(t->width * sizeof(bignum));
+  for(j = 0; j < t->width; j++) {
+    bn_init(&row->big[j]);
+    bn_set_ll(&row->big[j], row->v[j]);
+  }
+}
+
+//If all the coefficients of a promoted row fit again in 64 bits, we go back to the fast path
+
+static void exact_demote_row(exact_tableau* t, int i) {
+  int j;
+  exact_row* row = &t->rows[i];
+
+  if( !row->big )
+    return;
+
+  for(j = 0; j < t->width; j++) {
+    if( !bn_get_ll(&row->big[j], &t->scratch[j]) )
+      return;
+  }
+  for(j = 0; j < t->width; j++) {
+    row->v[j] = t->scratch[j];
+    bn_free(&row->big[j]);
+  }
+  free(row->big);
+  row->big = 0;
+}
+
+/*
+  Value k of the vector used by the lexicographic ratio test for row i. k = 0 is the value of the
+  variable in basis, and k = 1..nlines are the entries of row i of the inverse of the current basis,
+  which we read from the columns of the slack variables of this tableau (column 1 + k).
+*/
+
+static void exact_lex_value(exact_tableau* t, int i, int k, int slack0, bignum* out) {
+  if( k == 0 ) {
+    exact_entry(t, i, 1, out);
+  }
+  else if( t->basis[i] == slack0 - k + 1 ) {
+    exact_det(t, out);
+  }
+  else {
+    exact_entry(t, i, 1 + k, out);
+    out->sign = -out->sign;
+  }
+}
+
+static int exact_lex_value_small(exact_tableau* t, int i, int k, int slack0, long long* out) {
+  if( k == 0 ) {
+    *out = t->rows[i].v[1];
+  }
+  else if( t->basis[i] == slack0 - k + 1 ) {
+    if( t->det_is_big )
+      return 0;
+    *out = t->det;
+  }
+  else {
+    if( t->rows[i].v[1 + k] == LLONG_MIN )
+      return 0;
+    *out = - t->rows[i].v[1 + k];
+  }
+  return 1;
+}
+
+/*
+  Compares the ratios of rows i and b for the entering column c: returns a negative number if row i
+  is lexicographically smaller (so it should be chosen), positive if row b is.
+*/
+
+static int exact_compare_rows(exact_tableau* t, int i, int b, int column, int slack0) {
+  bignum x, y, di, db;
+  long long vi, vb;
+  int k, res = 0;
+
+  if( !t->rows[i].big && !t->rows[b].big ) {
+    __int128 ci = - (__int128) t->rows[i].v[column];
+    __int128 cb = - (__int128) t->rows[b].v[column];
+
+    for(k = 0; k <= t->nlines; k++) {
+      if( !exact_lex_value_small(t, i, k, slack0, &vi) || !exact_lex_value_small(t, b, k, slack0, &vb) )
+	break;
+      //Products of two 64 bit numbers (one of them at most 2^63 in absolute value) always fit in 128 bits
+      __int128 l = (__int128) vi * cb;
+      __int128 r = (__int128) vb * ci;
+      if( l != r )
+	return l < r ? -1 : 1;
+    }
+    if( k > t->nlines )
+      return 0;
+  }
+
+  bn_init(&x); bn_init(&y); bn_init(&di); bn_init(&db);
+  exact_entry(t, i, column, &di);
+  exact_entry(t, b, column, &db);
+  di.sign = -di.sign;
+  db.sign = -db.sign;
+
+  for(k = 0; k <= t->nlines && res == 0; k++) {
+    exact_lex_value(t, i, k, slack0, &x);
+    exact_lex_value(t, b, k, slack0, &y);
+    bn_mul(&x, &x, &db);
+    bn_mul(&y, &y, &di);
+    res = bn_cmp(&x, &y);
+  }
+
+  bn_free(&x); bn_free(&y); bn_free(&di); bn_free(&db);
+  return res;
+}
+
+/*
+  Updates row i (i != r) after the pivot row r has been rewritten. dnew is the new denominator and
+  dold the old one.
+*/
+
+static void exact_update_row_big(exact_tableau* t, int i, int r, int column, bignum* dnew, bignum* dold) {
+  bignum ci, trj, x;
+  int j;
+
+  exact_promote_row(t, i);
+  bn_init(&ci); bn_init(&trj); bn_init(&x);
+  bn_copy(&ci, &t->rows[i].big[column]);
+
+  for(j = 1; j < t->width; j++) {
+    if( j == column )
+      continue;
+    exact_entry(t, r, j, &trj);
+    bn_mul(&x, dnew, &t->rows[i].big[j]);
+    bn_mul(&trj, &ci, &trj);
+    bn_add(&x, &x, &trj);
+    bn_divmod(&t->rows[i].big[j], 0, &x, dold);
+  }
+  bn_set_ll(&t->rows[i].big[column], 0);
+
+  bn_free(&ci); bn_free(&trj); bn_free(&x);
+  exact_demote_row(t, i);
+}
+
+static int exact_update_row_small(exact_tableau* t, int i, int r, int column, long long dnew, long long dold) {
+  long long* row = t->rows[i].v;
+  long long* prow = t->rows[r].v;
+  long long* out = t->scratch;
+  long long ci = row[column];
+  __int128 x;
+  int j;
+
+  for(j = 1; j < t->width; j++) {
+    if( j == column )
+      continue;
+    x = (__int128) dnew * row[j] + (__int128) ci * prow[j];
+    if( dold != 1 )
+      x /= dold;
+    if( !LL_FITS(x) )
+      return 0;
+    out[j] = (long long) x;
+  }
+  out[column] = 0;
+
+  //The scratch row becomes the actual row, and the old row is recycled as scratch space
+  t->scratch = row;
+  t->rows[i].v = out;
+  return 1;
+}
+
+/*
+  Pivoting step: the variable 'entering' enters the basis in row r (column 'column'), and the variable
+  in basis in that row leaves it.
+*/
+
+static void exact_pivot(exact_tableau* t, int dim1, int dim2, int r, int column, int entering) {
+  bignum dnew, dold;
+  long long dnew_s = 0;
+  int i, dnew_small;
+  int leavecol = get_column(dim1, dim2, t->basis[r]);
+
+  bn_init(&dnew); bn_init(&dold);
+  exact_det(t, &dold);
+  exact_entry(t, r, column, &dnew);
+  dnew.sign = -dnew.sign;
+  dnew_small = bn_get_ll(&dnew, &dnew_s);
+
+  //The pivot row: the leaving variable moves on the right hand side with coefficient -det
+  if( t->det_is_big || t->det == LLONG_MIN )
+    exact_promote_row(t, r);
+  if( t->rows[r].big ) {
+    bn_copy(&t->rows[r].big[leavecol], &dold);
+    t->rows[r].big[leavecol].sign = -dold.sign;
+    bn_set_ll(&t->rows[r].big[column], 0);
+  }
+  else {
+    t->rows[r].v[leavecol] = -t->det;
+    t->rows[r].v[column] = 0;
+  }
+  t->basis[r] = entering;
+
+  for(i = 0; i < t->nlines; i++) {
+    if( i == r )
+      continue;
+
+    if( !t->rows[i].big && !t->rows[r].big && !t->det_is_big && dnew_small ) {
+      if( exact_update_row_small(t, i, r, column, dnew_s, t->det) )
+	continue;
+    }
+    exact_update_row_big(t, i, r, column, &dnew, &dold);
+  }
+  exact_demote_row(t, r);
+
+  if( dnew_small ) {
+    t->det = dnew_s;
+    t->det_is_big = 0;
+  }
+  else {
+    bn_copy(&t->det_big, &dnew);
+    t->det_is_big = 1;
+  }
+
+  bn_free(&dnew); bn_free(&dold);
+}
+
+static int exact_get_pivot(exact_tableau** tableaus, int strategy) {
+  int t, i;
+
+  for(t = 0; t < 2; t++) {
+    for(i = 0; i < tableaus[t]->nlines; i++) {
+      if( tableaus[t]->basis[i] == strategy )
+	return -strategy;
+    }
+  }
+
+  return strategy;
+}
+
+/*
+  Builds the equilibrium: the probability of each strategy in basis is its value divided by the sum
+  of the values of the strategies in basis of the same tableau (the denominator det cancels out).
+*/
+
+static equilibrium* exact_add_tableau(equilibrium* eq, exact_tableau* t) {
+  bignum tot, num, g, x, scale;
+  long long ln, ld;
+  int i;
+  char *s1, *s2, *s;
+
+  bn_init(&tot); bn_init(&num); bn_init(&g); bn_init(&x); bn_init(&scale);
+
+  for(i = 0; i < t->nlines; i++) {
+    if( t->basis[i] > 0 ) {
+      exact_entry(t, i, 1, &num);
+      bn_add(&tot, &tot, &num);
+    }
+  }
+
+  bn_set_ll(&scale, 1LL << 60);
+
+  for(i = 0; i < t->nlines; i++) {
+    if( t->basis[i] <= 0 )
+      continue;
+
+    exact_entry(t, i, 1, &num);
+
+    //The double approximation: (num * 2^60) / tot fits in 64 bits, because num <= tot
+    bn_mul(&x, &num, &scale);
+    bn_divmod(&x, 0, &x, &tot);
+    bn_get_ll(&x, &ln);
+    double prob = (double) ln / (double) (1LL << 60);
+
+    //The exact rational, reduced to lowest terms
+    if( bn_sign(&num) == 0 ) {
+      s = (char*) malloc(2);
+      sprintf(s, "0");
+    }
+    else {
+      bn_gcd(&g, &num, &tot);
+      bn_divmod(&x, 0, &num, &g);
+      s1 = bn_to_string(&x);
+      bn_divmod(&x, 0, &tot, &g);
+      if( bn_get_ll(&x, &ld) && ld == 1 ) {
+	s = s1;
+      }
+      else {
+	s2 = bn_to_string(&x);
+	s = (char*) malloc(strlen(s1) + strlen(s2) + 2);
+	sprintf(s, "%s/%s", s1, s2);
+	free(s1);
+	free(s2);
+      }
+    }
+
+    eq = add_strategy_exact(eq, t->basis[i], prob, s);
+  }
+
+  bn_free(&tot); bn_free(&num); bn_free(&g); bn_free(&x); bn_free(&scale);
+  return eq;
+}
+
+/*
+  The Lemke-Howson algorithm, following step by step lemke_howson_gen. The only difference in the
+  choice of the pivot row is that ties in the minimum ratio test are broken lexicographically
+  instead of choosing the first row.
+*/
+
+equilibrium* exact_lemke_howson(exact_tableau** tableaus, int dim1, int dim2, int startpivot, int* steps, int debug) {
+  int i, index, newpivot;
+
+  int pivot = exact_get_pivot(tableaus, startpivot);
+  *steps = 0;
+
+  for (;;) {
+    (*steps)++;
+
+    if( debug & 0x02 ) {
+      fprintf(stdout,"Step no. %d. First Tableau:\n",*steps);
+      exact_view_tableau(tableaus[0],stdout);
+      fprintf(stdout,"\nSecond Tableau:\n");
+      exact_view_tableau(tableaus[1],stdout);
+    }
+
+    int ntab = get_tableau(dim1,dim2,pivot);
+    exact_tableau* t = tableaus[ntab];
+    int column = get_column(dim1,dim2,pivot);
+
+    //Label of the first slack variable of this tableau, needed by the lexicographic test
+    int slack0 = ntab == 0 ? -1 : -dim1 - 1;
+
+    index = -1;
+    for(i = 0; i < t->nlines; i++) {
+      if( exact_entry_sign(t, i, column) >= 0 )
+	continue;
+      if( index < 0 || exact_compare_rows(t, i, index, column, slack0) < 0 )
+	index = i;
+    }
+
+    assert(index >= 0);
+
+    newpivot = t->basis[index];
+
+    if( debug & 0x01 )
+      fprintf(stdout,"Step %d. Label in basis: %d. \t Label out of basis: %d.\t Index of row: %d\n",*steps,pivot,newpivot,index);
+
+    exact_pivot(t, dim1, dim2, index, column, pivot);
+
+    pivot = -newpivot;
+
+    if (newpivot == startpivot || newpivot == -startpivot)
+      break;
+  }
+
+  equilibrium* eq = 0;
+  eq = exact_add_tableau(eq, tableaus[0]);
+  eq = exact_add_tableau(eq, tableaus[1]);
+
+  return eq;
+}
+
+/*
+  Enumeration of all equilibria reachable by the Lemke-Howson algorithm, exactly as all_lemke_gen.
+  The lexicographic rule makes each path reversible, so we restore the tableaus in the same way.
+*/
+
+eqlist* exact_all_lemke(exact_tableau** tableaus, int dim1, int dim2, int taboo, eqlist* lista, int* steps, int debug) {
+  int pivot, npassi, found;
+
+  for(pivot = 1; pivot <= dim1+dim2; pivot++) {
+    if( pivot != taboo ) {
+
+      equilibrium* eq = exact_lemke_howson(tableaus,dim1,dim2,pivot,&npassi,debug);
+      *steps += npassi;
+
+      if( !is_artificial(eq) ) {
+	lista = search_add_equilibrium(lista,eq,&found);
+	if( !found )
+	  lista = exact_all_lemke(tableaus,dim1,dim2,pivot,lista,steps,debug);
+	else
+	  free_equilibrium(eq);
+      }
+      else
+	free_equilibrium(eq);
+
+      free_equilibrium(exact_lemke_howson(tableaus,dim1,dim2,pivot,&npassi,debug));
+      *steps += npassi;
+    }
+  }
+
+  return lista;
+}
+
+void exact_view_tableau(exact_tableau* t, FILE* f) {
+  int i, j;
+  char* s;
+  bignum x;
+
+  bn_init(&x);
+  exact_det(t, &x);
+  s = bn_to_string(&x);
+  fprintf(f,"\nDenominator: %s",s);
+  free(s);
+
+  for( i = 0; i < t->nlines; i++ ) {
+    fprintf(f,"\n%d ",t->basis[i]);
+    for( j = 1; j < t->width; j++) {
+      exact_entry(t, i, j, &x);
+      s = bn_to_string(&x);
+      fprintf(f,"%s ",s);
+      free(s);
+    }
+  }
+  fprintf(f,"\n");
+
+  bn_free(&x);
+}
+
+void exact_free_systems(exact_tableau** tableaus) {
+  int t, i, j;
+
+  for(t = 0; t < 2; t++) {
+    for(i = 0; i < tableaus[t]->nlines; i++) {
+      if( tableaus[t]->rows[i].big ) {
+	for(j = 0; j < tableaus[t]->width; j++)
+	  bn_free(&tableaus[t]->rows[i].big[j]);
+	free(tableaus[t]->rows[i].big);
+      }
+      free(tableaus[t]->rows[i].v);
+    }
+    bn_free(&tableaus[t]->det_big);
+    free(tableaus[t]->rows);
+    free(tableaus[t]->basis);
+    free(tableaus[t]->scratch);
+    free(tableaus[t]);
+  }
+  free(tableaus);
+}
@@ -0,0 +1,43 @@
+#ifndef EXACT_H
+#define EXACT_H
+
+#include "bimatrix.h"
+#include "bignum.h"
+
+/*
+  Integer tableaus used by the exact engine. Each row keeps its coefficients as 64 bit integers
+  while they fit, and is promoted to bignums only when one of its coefficients overflows.
+*/
+
+typedef struct ex_row {
+  long long* v;
+  bignum* big; //NULL while the row fits in 64 bits
+} exact_row;
+
+typedef struct ex_tab {
+  int nlines;
+  int width;
+  int* basis;       //Label of the variable in basis for each row (the first column of the double tableaus)
+  long long det;    //Common denominator of all the coefficients of the tableau (when det_is_big is 0)
+  int det_is_big;
+  bignum det_big;
+  exact_row* rows;
+  long long* scratch;
+} exact_tableau;
+
+//Tells if all the payoffs are integers small enough to be handled by the exact engine
+int integer_bimatrix(double** bimatrix, int dim1, int dim2);
+
+//Creates the integer tableaus starting from the (positivized, integer) bimatrix
+exact_tableau** exact_create_systems(double** bimatrix, int dim1, int dim2);
+
+//Same as lemke_howson_gen and all_lemke_gen, using exact integer pivoting
+equilibrium* exact_lemke_howson(exact_tableau** tableaus, int dim1, int dim2, int startpivot, int* steps, int debug);
+eqlist* exact_all_lemke(exact_tableau** tableaus, int dim1, int dim2, int taboo, eqlist* lista, int* steps, int debug);
+
+//Debug output
+void exact_view_tableau(exact_tableau* tableau, FILE* f);
+
+void exact_free_systems(exact_tableau** tableaus);
+
+#endif
@@ -3,24 +3,86 @@
 #include <getopt.h>
 #include <assert.h>
 #include <sys/time.h>
+#include <strings.h>
+#include <unistd.h>
 
 #include "algorithm.h"
+#include "exact.h"
+#include "cache.h"
+#include "simplex.h"
+#include "verify.h"
+#include "batch.h"
+#include "daemon.h"
+#include "checkpoint.h"
+#include "approx.h"
+#include "tune.h"
+#include "shard.h"
 
-void single_lemke_exec();
-void all_lemke_exec();
+//Pivoting engines
+#define ENGINE_AUTO 0   //Simplex method on constant-sum games, double engine otherwise
+#define ENGINE_DOUBLE 1
+#define ENGINE_EXACT 2
+#define ENGINE_SYMMETRIC 3  //Single tableau for symmetric games (double arithmetic)
+#define ENGINE_LP 4         //Simplex method for constant-sum games
+#define ENGINE_APPROX 5     //Regret dynamics: approximate equilibrium of very large games
+
+//Checks of the results
+#define VERIFY_NONE 0
+#define VERIFY_CHECK 1
+#define VERIFY_REFINE 2
+
+int single_lemke_exec();
+int all_lemke_exec();
+void lowmem_lemke_exec();
+int auto_pivot_threads();
+void thread_scaling_report();
+void batch_lemke_exec();
+int verify_eqlist();
+int choose_engine();
+int daemon_solve(void* engine_option, daemon_workspace* ws, double** bimatrix, int dim1, int dim2, double min, int pivot, FILE* out, int* steps);
 
 int main(int argc, char **argv)
 {
   FILE *input;
   int c;
-  int sing_l = 0, all_l = 0, readgame = 0, debug_mask = 0, gambit_output = 0, summary = 0;
+  int sing_l = 0, all_l = 0, readgame = 0, debug_mask = 0, gambit_output = 0, summary = 0, symmetric = 0;
   double** bimatrix;
   char inputfile[100];
   int startpivot = 1;
   double minimo = 0.0;
   int dim1 = 10, dim2 = 10;
+  int engine = ENGINE_AUTO;
+  char* cachefile = 0;
+  result_cache* cache;
+  char* outputfile = 0;
+  FILE* output;
+  char title[100];
+  int seeded = 0, gen_threads = 0;
+  int verify = VERIFY_NONE, failed = 0;
+  int lowmem = 0;
+  int pivot_threads = 0, scaling = 0, batch = 0;
+  double*** tableaus;
+  struct timeval tim;
+  unsigned long long seed = 0, game_index = 0;
+  char* daemon_path = 0;
+  char* client_path = 0;
+  int connections = 1, depth = 1;
+  const char* error;
+  checkpoint ckpt;
+  char* ckptfile = 0;
+  char* tableaufile = 0;
+  approx_options approx;
+  char* tunefile = 0;
+  int calibrate = 0, tunereport = 0;
+  tune_profile profile;
+  tune_profile* tuned = 0;
+  int workers = 0;
+
+  memset(&ckpt, 0, sizeof(ckpt));
+  ckpt.interval = CHECKPOINT_INTERVAL;
+  approx_default_options(&approx);
 
-  while ((c = getopt(argc, argv, "p:i:w:l:d:Ghas")) != -1) {
+  while ((c = getopt(argc, argv, "p:i:w:l:d:e:c:r:g:t:o:P:T:n:D:C:N:Q:k:K:E:I:O:U:j:GhasSvVmRYAq")) != -1) {
     switch (c) {
     case 'p':
       sing_l = 1;
@@ -42,14 +104,112 @@ int main(int argc, char **argv)
     case 'd':
       debug_mask = atoi(optarg);
       break;
+    case 'e':
+      if( strcmp(optarg,"auto") == 0 )
+	engine = ENGINE_AUTO;
+      else if( strcmp(optarg,"double") == 0 )
+	engine = ENGINE_DOUBLE;
+      else if( strcmp(optarg,"exact") == 0 )
+	engine = ENGINE_EXACT;
+      else if( strcmp(optarg,"lp") == 0 )
+	engine = ENGINE_LP;
+      else if( strcmp(optarg,"approx") == 0 )
+	engine = ENGINE_APPROX;
+      else {
+	fprintf(stderr,"Unknown engine %s: it must be one of auto, double, exact, lp, approx\n",optarg);
+	return -1;
+      }
+      break;
+    case 'c':
+      cachefile = optarg;
+      break;
+    case 'r':
+      seeded = 1;
+      seed = strtoull(optarg, 0, 0);
+      break;
+    case 'g':
+      game_index = strtoull(optarg, 0, 0);
+      break;
+    case 't':
+      gen_threads = atoi(optarg);
+      break;
+    case 'o':
+      outputfile = optarg;
+      break;
     case 'G':
       gambit_output = 1;
       break;
     case 's':
       summary = 1;
       break;
+    case 'S':
+      symmetric = 1;
+      break;
+    case 'v':
+      verify = verify > VERIFY_CHECK ? verify : VERIFY_CHECK;
+      break;
+    case 'V':
+      verify = VERIFY_REFINE;
+      break;
+    case 'm':
+      lowmem = 1;
+      break;
+    case 'P':
+      pivot_threads = atoi(optarg);
+      break;
+    case 'T':
+      scaling = atoi(optarg);
+      break;
+    case 'n':
+      batch = atoi(optarg);
+      break;
+    case 'D':
+      daemon_path = optarg;
+      break;
+    case 'C':
+      client_path = optarg;
+      break;
+    case 'N':
+      connections = atoi(optarg);
+      break;
+    case 'Q':
+      depth = atoi(optarg);
+      break;
+    case 'k':
+      ckptfile = optarg;
+      break;
+    case 'K':
+      ckpt.interval = atof(optarg);
+      break;
+    case 'R':
+      ckpt.resume = 1;
+      break;
+    case 'E':
+      approx.target = atof(optarg);
+      break;
+    case 'I':
+      approx.iterations = atoi(optarg);
+      break;
+    case 'Y':
+      approx.polish = 1;
+      break;
+    case 'O':
+      tableaufile = optarg;
+      break;
+    case 'U':
+      tunefile = optarg;
+      break;
+    case 'A':
+      calibrate = 1;
+      break;
+    case 'q':
+      tunereport = 1;
+      break;
+    case 'j':
+      workers = atoi(optarg);
+      break;
     case 'h':
-      fprintf(stderr, "Usage: ./lemkehowson\n\t\t\t[-i gamefile.NFG (by default generates a random game)]\n\t\t\t[-w DIM1 -l DIM2 (used only to generate a random game of size DIM1xDIM2. Default is 10 x 10)]\n\t\t\t[-p PIVOT (Executes the Lemke-Howson algorithm once, pivoting on strategy PIVOT)]\n\t\t\t[-a (Searches all equilibria reachable by the Lemke-Howson algorithm)]\n\t\t\t[-d DEBUG_LEVEL (Determines the level of debug output)]\n\t\t\t[-G (With this option turned on, the output is similar to that of Gambit, to semplify testing and benchmarking)]\n");
+      fprintf(stderr, "Usage: ./lemkehowson\n\t\t\t[-i gamefile.NFG (by default generates a random game. Binary game files written with -o are accepted too)]\n\t\t\t[-w DIM1 -l DIM2 (used only to generate a random game of size DIM1xDIM2. Default is 10 x 10)]\n\t\t\t[-r SEED -g INDEX (The random game is the game number INDEX of the given SEED, the same on every machine. Default is a seed taken from the clock, and index 0)]\n\t\t\t[-t THREADS (Number of threads used to generate the random game. Default is one per processor on big games)]\n\t\t\t[-o OUTFILE (Writes the game to OUTFILE, in NFG format if its name ends with .nfg and in binary format otherwise. Without -p or -a the program stops there)]\n\t\t\t[-p PIVOT (Executes the Lemke-Howson algorithm once, pivoting on strategy PIVOT)]\n\t\t\t[-a (Searches all equilibria reachable by the Lemke-Howson algorithm)]\n\t\t\t[-d DEBUG_LEVEL (Determines the level of debug output)]\n\t\t\t[-G (With this option turned on, the output is similar to that of Gambit, to semplify testing and benchmarking)]\n\t\t\t[-e ENGINE (auto, double, exact, lp or approx. By default constant-sum games are solved with the simplex method (lp), and the others with the double engine. exact needs integer payoffs and is never chosen by default: it prints the probabilities as fractions, and on degenerate games it can find other equilibria than the double engine. approx finds an approximate equilibrium with regret dynamics, and is never chosen by default)]\n\t\t\t[-c CACHEFILE (Keeps the results in a cache file shared by all executions, and reports the hit rates in the summary)]\n\t\t\t[-S (Looks only for symmetric equilibria of a symmetric game, using a single tableau. With -p this is done automatically when the game is symmetric)]\n\t\t\t[-v (Verifies the equilibria found, printing the regret of both players. The exit status is 2 if one of them is not an equilibrium)]\n\t\t\t[-V (Same as -v, but before the check the probabilities are computed again on the support of the equilibrium, in extended precision)]\n\t\t\t[-m (Low memory mode: the game is read or generated directly into the tableaus, without keeping the payoffs. Only the double engine is available, and -c, -v, -V, -S, -o cannot be used)]\n\t\t\t[-O TABLEAUFILE (Out-of-core mode, for tableaus larger than memory: same as -m, but the tableaus are kept in TABLEAUFILE, a new file which is removed at the end, and only the rows that a pivot changes are read. The pivots are not split among threads)]\n\t\t\t[-P THREADS (Number of threads sharing the work of each pivoting step. Default is one per processor on games big enough to gain from it, one thread otherwise)]\n\t\t\t[-T THREADS (Runs the Lemke-Howson algorithm from pivot -p with 1, 2, 4, ... up to THREADS pivoting threads, and reports the time and speedup of each run)]\n\t\t\t[-n COUNT (Batch mode: solves the random games INDEX, ..., INDEX+COUNT-1 of the seed with the Lemke-Howson algorithm from pivot -p, and reports the throughput. The games are solved one at a time, unless the tuning profile of -U shows that solving several games at a time in vector lanes is faster for their size. With -e double they are always solved one at a time)]\n\t\t\t[-D SOCKET (Daemon mode: stays resident and solves the games sent on the Unix socket SOCKET, or on stdin and stdout if SOCKET is -, with the engine of -e and the cache of -c. See daemon.h for the protocol)]\n\t\t\t[-C SOCKET (Client of the daemon listening on SOCKET: sends the game of -i, or the random games INDEX, INDEX+1, ... of the seed, looking for the equilibrium of -p or for all of them with -a, and reports the throughput and the percentiles of the latency. -n sets the number of requests (default 1 with -i, 1000 otherwise), and with -G the equilibria are printed)]\n\t\t\t[-N CONNECTIONS -Q DEPTH (Used with -C: number of connections to the daemon, and of requests in flight on each one. Default is 1 and 1)]\n\t\t\t[-k CKPTFILE (Used with -a: writes the state of the enumeration to CKPTFILE every -K seconds, and when the program is stopped by SIGINT or SIGTERM, in which case the exit status is 3. Only the double engine is available)]\n\t\t\t[-K SECONDS (Seconds between two checkpoints. Default is 60: the interval grows if writing the checkpoints would take more than 1%% of the time)]\n\t\t\t[-R (Used with -k: resumes the enumeration from CKPTFILE, if it exists)]\n\t\t\t[-E EPS (Used with -e approx: the dynamics stop when the regret of both players is below EPS times the range of the payoffs. Default is 1e-3)]\n\t\t\t[-I ITERATIONS (Used with -e approx: maximum number of iterations of the dynamics. Default is 10000)]\n\t\t\t[-Y (Used with -e approx: solves the indifference equations on the support of the approximate equilibrium, and keeps the solution if its regret is lower)]\n\t\t\t[-U PROFILE (Reads the tuning profile of the host from PROFILE, and chooses from its crossovers when the pivots and ratio tests are split among threads, and whether batch mode uses the vector lanes)]\n\t\t\t[-A (Calibrates the kernels on synthetic games and writes the profile of -U, with the threads of -P. Takes a few seconds)]\n\t\t\t[-q (Prints the measurements and crossovers of the profile of -U, and the decisions for a game of size -w x -l)]\n\t\t\t[-j WORKERS (Used with -a: the paths are walked by WORKERS processes sharing the payoffs and the equilibria found in shared memory. A worker that dies is replaced, and its path walked again. Only the double engine is available)]\n\t\t\t[-s (Prints only a summary: number of pivoting steps, and support size or number of equilibria)]\n");
       return 0;
       break;
     default:
@@ -57,42 +217,239 @@ int main(int argc, char **argv)
     }
   }
 
+  if( sing_l && all_l ) {
+    fprintf(stderr,"You must choose whether to look for a single equilibrium with the Lemke-Howson algorithm with [-p PIVOT] or to have a list of all equilibria reachable by Lemke-Howson (with [-a])\n");
+    exit(1);
+  }
+
+  if( !seeded ) {
+    gettimeofday(&tim, NULL);
+    seed = (unsigned long long) (tim.tv_sec * 1000000 + tim.tv_usec);
+  }
+
+  if( engine == ENGINE_APPROX && (all_l || daemon_path || client_path || batch > 0) ) {
+    fprintf(stderr,"The approximate engine looks for a single equilibrium (-p), and cannot be used with -a, -D, -C, -n\n");
+    exit(1);
+  }
+  approx.threads = pivot_threads;
+
+  if( calibrate || tunereport ) {
+    if( !tunefile ) {
+      fprintf(stderr,"The calibration (-A) and the report (-q) need the file of the profile (-U)\n");
+      exit(1);
+    }
+    if( calibrate ) {
+      tune_calibrate(&profile,pivot_threads,stderr);
+      if( tune_save(&profile,tunefile) ) {
+	fprintf(stderr,"Cannot write %s\n",tunefile);
+	exit(1);
+      }
+    }
+    else if( tune_load(&profile,tunefile) ) {
+      fprintf(stderr,"%s is not a tuning profile\n",tunefile);
+      exit(1);
+    }
+    tune_report(&profile,dim1,dim2,stdout);
+    return 0;
+  }
+
+  if( tunefile ) {
+    if( tune_load(&profile,tunefile) ) {
+      fprintf(stderr,"%s is not a tuning profile\n",tunefile);
+      exit(1);
+    }
+    tune_apply(&profile);
+    tuned = &profile;
+  }
+
+  if( daemon_path ) {
+    daemon_serve(daemon_path,daemon_solve,&engine,cachefile);
+    return 0;
+  }
+
+  if( client_path ) {
+    daemon_load load;
+    load.gamefile = readgame ? inputfile : 0;
+    load.dim1 = dim1;
+    load.dim2 = dim2;
+    load.seed = seed;
+    load.first = game_index;
+    load.pivot = all_l ? 0 : startpivot;
+    load.count = batch > 0 ? batch : (readgame ? 1 : 1000);
+    load.connections = connections;
+    load.depth = depth;
+    load.print = gambit_output;
+    return daemon_client(client_path,&load) ? 2 : 0;
+  }
+
+  if( batch > 0 ) {
+    if( readgame || all_l || (engine != ENGINE_AUTO && engine != ENGINE_DOUBLE) ) {
+      fprintf(stderr,"Batch mode works only on random games, looking for one equilibrium with the double engine\n");
+      exit(1);
+    }
+    //The lanes are not faster everywhere: without a profile measuring them on the host, the games go one at a time
+    batch_lemke_exec(dim1,dim2,startpivot,batch,seed,game_index,gambit_output,summary,
+		     engine == ENGINE_DOUBLE || !tuned || !tune_batch_lanes(tuned,dim1,dim2));
+    return 0;
+  }
+
+/*
+  In low memory mode the payoffs exist only in the tableaus, so everything that needs the bimatrix
+  (the other engines, the cache, the verification, the output of the game) is unavailable. The
+  out-of-core mode is the same, with the tableaus on a file.
+*/
+
+  if( ckptfile ) {
+    if( !all_l || (engine != ENGINE_AUTO && engine != ENGINE_DOUBLE) || symmetric ) {
+      fprintf(stderr,"Checkpoints are written only by the enumeration of all equilibria (-a) with the double engine, without -S\n");
+      exit(1);
+    }
+    engine = ENGINE_DOUBLE;
+    ckpt.file = ckptfile;
+  }
+
+  if( workers ) {
+    if( !all_l || (engine != ENGINE_AUTO && engine != ENGINE_DOUBLE) || symmetric || ckptfile || lowmem || tableaufile ) {
+      fprintf(stderr,"The worker processes enumerate all equilibria (-a) with the double engine, without -S, -k, -m, -O\n");
+      exit(1);
+    }
+    if( workers < 0 || workers > SHARD_MAX_WORKERS ) {
+      fprintf(stderr,"The number of workers must be between 1 and %d\n",SHARD_MAX_WORKERS);
+      exit(1);
+    }
+    engine = ENGINE_DOUBLE;
+  }
+
+  if( lowmem || tableaufile ) {
+    if( (engine != ENGINE_AUTO && engine != ENGINE_DOUBLE) || cachefile || verify || symmetric || outputfile || ckptfile ) {
+      fprintf(stderr,"Low memory and out-of-core modes work only with the double engine, and without -c, -v, -V, -S, -o, -k\n");
+      exit(1);
+    }
+    if( tableaufile )
+      set_tableau_file(tableaufile);
+
+    if( readgame ) {
+      input = fopen(inputfile, "r");
+      if( !input ) {
+	fprintf(stderr,"Cannot open %s\n",inputfile);
+	exit(1);
+      }
+      if( is_binary_game(input) )
+	tableaus = binary_import_systems(input, &minimo, &dim1, &dim2);
+      else
+	tableaus = gamut_import_systems(input, &minimo, &dim1, &dim2);
+      fclose(input);
+    }
+    else {
+      tableaus = get_random_systems_seeded(dim1,dim2,seed,game_index,&minimo);
+    }
+
+    //The out-of-core kernels are serial: they wait for the disk more than they compute
+    set_pivot_threads(tableaufile ? 1 : auto_pivot_threads(pivot_threads,dim1,dim2,tuned));
+    if( sing_l || all_l )
+      lowmem_lemke_exec(tableaus,dim1,dim2,all_l,startpivot,minimo,gambit_output,summary,debug_mask,tableaufile != 0);
+    set_pivot_threads(1);
+    free_tableaus(tableaus,dim1,dim2);
+    return 0;
+  }
+
 /*
   If we don't read the game from a file, by default we generate a uniformely random game
 */
 
   if (!readgame) {
-    bimatrix = (double**) get_random_bimatrix_gen(dim1,dim2, &minimo);
+    bimatrix = get_random_bimatrix_seeded(dim1,dim2,seed,game_index,gen_threads,&minimo);
+    snprintf(title, 100, "Random game %llu of seed %llu", game_index, seed);
   } 
   else {
     input = fopen(inputfile, "r");
-    bimatrix = gamut_import_bimatrix(input, &minimo, &dim1, &dim2);
+    if( !input ) {
+      fprintf(stderr,"Cannot open %s\n",inputfile);
+      exit(1);
+    }
+    if( is_binary_game(input) )
+      bimatrix = binary_import_bimatrix(input, &minimo, &dim1, &dim2);
+    else
+      bimatrix = gamut_import_bimatrix(input, &minimo, &dim1, &dim2);
     fclose(input);
+    snprintf(title, 100, "%s", inputfile);
   }
 
-  if( sing_l && all_l ) {
-    fprintf(stderr,"You must choose whether to look for a single equilibrium with the Lemke-Howson algorithm with [-p PIVOT] or to have a list of all equilibria reachable by Lemke-Howson (with [-a])\n");
+  if( outputfile ) {
+    output = fopen(outputfile, "w");
+    if( !output ) {
+      fprintf(stderr,"Cannot write %s\n",outputfile);
+      exit(1);
+    }
+    if( strlen(outputfile) > 4 && strcasecmp(outputfile + strlen(outputfile) - 4, ".nfg") == 0 )
+      nfg_export_bimatrix(bimatrix,dim1,dim2,title,output);
+    else
+      binary_export_bimatrix(bimatrix,dim1,dim2,output);
+    fclose(output);
+
+    if( !sing_l && !all_l ) {
+      free_bimatrix(bimatrix,dim1,dim2);
+      return 0;
+    }
+  }
+
+  if( scaling ) {
+    thread_scaling_report(bimatrix,dim1,dim2,startpivot,minimo,scaling);
+    return 0;
+  }
+
+  engine = choose_engine(bimatrix,dim1,dim2,engine,symmetric,all_l,&error);
+  if( engine < 0 ) {
+    fprintf(stderr,"%s\n",error);
     exit(1);
   }
-  
+  cache = cache_create(CACHE_MEMORY_ENTRIES,cachefile);
+
+  //The exact engine has its own pivoting, which doesn't use the threads, and the approximate one has its own pool
+  if( engine != ENGINE_EXACT && engine != ENGINE_APPROX )
+    set_pivot_threads(auto_pivot_threads(pivot_threads,dim1,dim2,tuned));
+
   if( sing_l ) {
-    single_lemke_exec(bimatrix,dim1,dim2,startpivot,minimo,gambit_output,summary,debug_mask);
+    failed = single_lemke_exec(bimatrix,dim1,dim2,startpivot,minimo,gambit_output,summary,debug_mask,engine,cache,verify,&approx);
   }
   else if( all_l ) {
-    all_lemke_exec(bimatrix,dim1,dim2,minimo,gambit_output,debug_mask);
+    failed = all_lemke_exec(bimatrix,dim1,dim2,minimo,gambit_output,summary,debug_mask,engine,cache,verify,ckptfile ? &ckpt : 0,workers);
   }
 
-  return 0;
+  set_pivot_threads(1);
+  cache_free(cache);
+  return failed ? 2 : 0;
 }
 
 /*
-  This way the program executes the Lemke-Howson algorithm one single time, pivoting on the desired strategy,
-  on the game specified (it can be a random game or a game imported from a NFG file).
+  The number of pivoting threads, when not chosen by the user: one per processor if the biggest tableau
+  is large enough for the kernels to split its pivots, one otherwise. With a tuning profile, the size
+  and the number of threads are those measured on the host.
 */
 
-void single_lemke_exec(double** bimatrix, int dim1, int dim2, int pivot, double min, int gambit_output, int summary, int debug_mask) {
-  int passi;
+int auto_pivot_threads(int threads, int dim1, int dim2, tune_profile* tuned) {
+  if( threads > 0 )
+    return threads;
+  if( tuned )
+    return tune_pivot_threads(tuned,dim1,dim2);
+
+  if( (long) (dim1 > dim2 ? dim1 : dim2) * (2 + dim1 + dim2) < PIVOT_PARALLEL_MIN )
+    return 1;
+
+  return (int) sysconf(_SC_NPROCESSORS_ONLN);
+}
+
+/*
+  Runs the Lemke-Howson algorithm from the same pivot with a growing number of pivoting threads, on a
+  fresh copy of the tableaus each time, and prints the speedup with respect to the single thread run.
+*/
+
+void thread_scaling_report(double** bimatrix, int dim1, int dim2, int pivot, double min, int maxthreads) {
   double*** tableaus;
+  equilibrium* eq;
+  struct timeval start, end;
+  double elapsed, base = 0.0;
+  int threads, passi;
 
   if( pivot <= 0 || pivot > (dim1+dim2) ) {
     fprintf(stderr,"Starting pivot must be a number between 1 and DIM1 + DIM2\n");
@@ -101,12 +458,157 @@ void single_lemke_exec(double** bimatrix, int dim1, int dim2, int pivot, double
 
   positivize_bimatrix(bimatrix,dim1,dim2,min);
 
-  tableaus = create_systems(bimatrix,dim1,dim2);
-  
-  equilibrium* eq = lemke_howson_gen(tableaus,bimatrix,dim1,dim2,pivot,&passi,debug_mask);
+  fprintf(stdout,"Threads\tSeconds\t\tSpeedup\tPivots\n");
+  for(threads = 1; ; threads = (threads * 2 > maxthreads && threads < maxthreads) ? maxthreads : threads * 2) {
+    set_pivot_threads(threads);
+    tableaus = create_systems(bimatrix,dim1,dim2);
+
+    gettimeofday(&start, NULL);
+    eq = lemke_howson_gen(tableaus,bimatrix,dim1,dim2,pivot,&passi,0,0);
+    gettimeofday(&end, NULL);
+
+    elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+    base = threads == 1 ? elapsed : base;
+    fprintf(stdout,"%d\t%.6lf\t%.2lf\t%d\n",threads,elapsed,elapsed > 0.0 ? base / elapsed : 0.0,passi);
+
+    free_equilibrium(eq);
+    free_tableaus(tableaus,dim1,dim2);
+    if( threads >= maxthreads )
+      break;
+  }
+
+  if( get_pivot_parallel_min() < 0 )
+    fprintf(stdout,"The tuning profile never splits the pivots among threads\n");
+  else if( (long) (dim1 > dim2 ? dim1 : dim2) * (2 + dim1 + dim2) < get_pivot_parallel_min() )
+    fprintf(stdout,"The tableaus of this game are below the size at which pivots are split among threads (%ld coefficients)\n",get_pivot_parallel_min());
+
+  set_pivot_threads(1);
+  free_bimatrix(bimatrix,dim1,dim2);
+}
+
+/*
+  The exact engine works only on integer payoffs, and is used only when the user asks for it: its
+  probabilities are fractions, and on degenerate games its lexicographic ratio test can end the paths
+  on other equilibria than the double engine, so choosing it by default would change the output.
+
+  Constant-sum games don't need the Lemke-Howson algorithm at all: they are solved by a single linear
+  program, and their set of equilibria is convex.
+
+  Symmetric games have precedence over the choice between exact and double engine when looking for a
+  single equilibrium: the single tableau halves the work. When looking for all equilibria we use it only
+  if the user asks (with -S), because it finds only the symmetric ones.
+
+  The approximate engine is used only when asked for: its result is not an exact equilibrium.
+*/
+
+int choose_engine(double** bimatrix, int dim1, int dim2, int engine, int symmetric, int all, const char** error) {
+  int integer = integer_bimatrix(bimatrix,dim1,dim2);
+
+  if( symmetric && !is_symmetric_bimatrix(bimatrix,dim1,dim2) ) {
+    *error = "The game is not symmetric";
+    return -1;
+  }
+  if( engine == ENGINE_EXACT && !integer ) {
+    *error = "The exact engine needs integer payoffs (less than 2^31 in absolute value)";
+    return -1;
+  }
+  if( engine == ENGINE_LP && !is_constant_sum_bimatrix(bimatrix,dim1,dim2) ) {
+    *error = "The simplex engine can only solve constant-sum games";
+    return -1;
+  }
+
+  if( engine == ENGINE_APPROX )
+    return ENGINE_APPROX;
+
+  if( engine == ENGINE_LP || (engine == ENGINE_AUTO && !symmetric && is_constant_sum_bimatrix(bimatrix,dim1,dim2)) )
+    return ENGINE_LP;
+
+  if( engine != ENGINE_EXACT && (symmetric || (!all && is_symmetric_bimatrix(bimatrix,dim1,dim2))) )
+    return ENGINE_SYMMETRIC;
+  if( engine == ENGINE_AUTO )
+    return ENGINE_DOUBLE;
+
+  return engine;
+}
+
+/*
+  This way the program executes the Lemke-Howson algorithm one single time, pivoting on the desired strategy,
+  on the game specified (it can be a random game or a game imported from a NFG file).
+*/
+
+int single_lemke_exec(double** bimatrix, int dim1, int dim2, int pivot, double min, int gambit_output, int summary, int debug_mask, int engine, result_cache* cache, int verify, approx_options* approx) {
+  int passi, failed;
+  double*** tableaus = 0;
+  double** sym_tableau = 0;
+  double** lp_tableau = 0;
+  exact_tableau** ex_tableaus = 0;
+  equilibrium* eq;
+  int unique;
+  eqlist* cached = 0;
+  eqlist single;
+  cache_key key;
+  approx_result approx_res;
+
+  if( pivot <= 0 || pivot > (dim1+dim2) ) {
+    fprintf(stderr,"Starting pivot must be a number between 1 and DIM1 + DIM2\n");
+    exit(1);
+  }
+
+  /*
+    The key is computed on the payoffs as they were given, before positivization. We don't use the
+    cache when debugging, because we want to see the execution of the algorithm, nor with the approximate
+    engine, whose result depends on the target and on the number of iterations.
+  */
+  cache_make_key(&key,bimatrix,dim1,dim2,pivot,0,engine);
+
+  if( !debug_mask && engine != ENGINE_APPROX && cache_lookup(cache,&key,&cached,&passi) ) {
+    eq = cached->eq;
+    cached->eq = 0;
+    free_eqlist(cached);
+  }
+  else {
+    positivize_bimatrix(bimatrix,dim1,dim2,min);
+
+    if( engine == ENGINE_EXACT ) {
+      ex_tableaus = exact_create_systems(bimatrix,dim1,dim2);
+      eq = exact_lemke_howson(ex_tableaus,dim1,dim2,pivot,&passi,debug_mask);
+    }
+    else if( engine == ENGINE_SYMMETRIC ) {
+      //Strategy k of the second player is identified with strategy k of the first one
+      sym_tableau = create_symmetric_system(bimatrix,dim1);
+      eq = lemke_howson_sym(sym_tableau,dim1,pivot > dim1 ? pivot - dim1 : pivot,&passi,debug_mask);
+    }
+    else if( engine == ENGINE_LP ) {
+      //The starting pivot is meaningless here: the simplex method finds an equilibrium directly
+      lp_tableau = create_lp_system(bimatrix,dim1,dim2);
+      eq = constant_sum_simplex(lp_tableau,dim1,dim2,&passi,&unique,debug_mask);
+    }
+    else if( engine == ENGINE_APPROX ) {
+      //Same for the approximate engine, which reports its iterations as steps
+      eq = approx_equilibrium(bimatrix,dim1,dim2,approx,&approx_res);
+      passi = approx_res.iterations;
+    }
+    else {
+      tableaus = create_systems(bimatrix,dim1,dim2);
+      eq = lemke_howson_gen(tableaus,bimatrix,dim1,dim2,pivot,&passi,0,debug_mask);
+    }
+
+    //The cache stores lists of equilibria, so we wrap the equilibrium in a list with a single element
+    single.eq = eq;
+    single.next = 0;
+    if( engine != ENGINE_APPROX )
+      cache_store(cache,&key,&single,passi);
+  }
+
+  single.eq = eq;
+  single.next = 0;
+  if( verify == VERIFY_REFINE )
+    verify_eqlist(bimatrix,dim1,dim2,&single,1,0);
 
   if(summary) {
     fprintf(stdout,"%d %d\n",passi,eq_size(eq));
+    if( cache->fd >= 0 )
+      cache_print_stats(cache,stdout);
   }
   else if(gambit_output) {
     print_equilibrium_gambit(eq,dim1,dim2,stdout);
@@ -115,12 +617,24 @@ void single_lemke_exec(double** bimatrix, int dim1, int dim2, int pivot, double
     print_equilibrium(eq,stdout);
   }
 
-  if(!summary)
+  if( engine == ENGINE_APPROX )
+    approx_print_result(approx,&approx_res,gambit_output || summary ? stderr : stdout);
+  else if(!summary)
     fprintf(stdout,"Number of complementary pivoting steps performed by the algorithm: %d\n",passi);
 
+  failed = verify ? verify_eqlist(bimatrix,dim1,dim2,&single,0,gambit_output || summary ? stderr : stdout) : 0;
+
   free_equilibrium(eq);
-  free_tableaus(tableaus,dim1,dim2);
+  if( tableaus )
+    free_tableaus(tableaus,dim1,dim2);
+  if( sym_tableau )
+    free_symmetric_system(sym_tableau,dim1);
+  if( lp_tableau )
+    free_lp_system(lp_tableau,dim1);
+  if( ex_tableaus )
+    exact_free_systems(ex_tableaus);
   free_bimatrix(bimatrix,dim1,dim2);
+  return failed;
 }
 
 /*
@@ -129,24 +643,336 @@ void single_lemke_exec(double** bimatrix, int dim1, int dim2, int pivot, double
   an equilibrium we already found before.
 */
 
-void all_lemke_exec(double** bimatrix, int dim1, int dim2, double min, int gambit_output, int debug_mask) {
-  double*** tableaus;
-  eqlist* found_equilibria;
+int all_lemke_exec(double** bimatrix, int dim1, int dim2, double min, int gambit_output, int summary, int debug_mask, int engine, result_cache* cache, int verify, checkpoint* ckpt, int workers) {
+  double*** tableaus = 0;
+  double** sym_tableau = 0;
+  double** lp_tableau = 0;
+  exact_tableau** ex_tableaus = 0;
+  eqlist* found_equilibria = 0;
+  int passi = 0, unique = -1, found, failed, memoized = 0, sharded = 0;
+  cache_key key;
+  lh_memo memo;
+  shard_stats shard;
 
-  positivize_bimatrix(bimatrix,dim1,dim2,min);
+  cache_make_key(&key,bimatrix,dim1,dim2,0,1,engine);
+
+  if( debug_mask || !cache_lookup(cache,&key,&found_equilibria,&passi) ) {
+    positivize_bimatrix(bimatrix,dim1,dim2,min);
   
-  tableaus = create_systems(bimatrix,dim1,dim2);
+    if( engine == ENGINE_EXACT ) {
+      ex_tableaus = exact_create_systems(bimatrix,dim1,dim2);
+      found_equilibria = exact_all_lemke(ex_tableaus,dim1,dim2,-1,(eqlist*)0,&passi,debug_mask);
+    }
+    else if( engine == ENGINE_SYMMETRIC ) {
+      sym_tableau = create_symmetric_system(bimatrix,dim1);
+      found_equilibria = all_lemke_sym(sym_tableau,dim1,-1,(eqlist*)0,&passi,debug_mask);
+    }
+    else if( engine == ENGINE_LP ) {
+      //Instead of enumerating the vertices of a convex set with LH, we give one equilibrium and report the convexity
+      lp_tableau = create_lp_system(bimatrix,dim1,dim2);
+      found_equilibria = search_add_equilibrium((eqlist*)0,constant_sum_simplex(lp_tableau,dim1,dim2,&passi,&unique,debug_mask),&found);
+    }
+    else if( ckpt ) {
+      //The checkpoints identify the game with the key of the cache, computed before positivization
+      ckpt->key = key;
+      tableaus = create_systems(bimatrix,dim1,dim2);
+      memo_init(&memo,dim1+dim2);
+      memoized = 1;
+      found_equilibria = all_lemke_checkpointed(tableaus,bimatrix,dim1,dim2,&passi,&memo,debug_mask,ckpt);
+      checkpoint_print_stats(ckpt,stderr);
+    }
+    else if( workers > 0 ) {
+      found_equilibria = all_lemke_sharded(bimatrix,dim1,dim2,workers,&passi,debug_mask,&shard);
+      sharded = 1;
+    }
+    else {
+      tableaus = create_systems(bimatrix,dim1,dim2);
+      memo_init(&memo,dim1+dim2);
+      memoized = 1;
+      found_equilibria = all_lemke_gen(tableaus,bimatrix,dim1,dim2,-1,(eqlist*)0,&passi,&memo,debug_mask);
+    }
 
-  found_equilibria = all_lemke_gen(tableaus,bimatrix,dim1,dim2,-1,(eqlist*)0,debug_mask);
+    //A sharded enumeration that stopped early is printed, but not kept
+    if( !sharded || !shard.incomplete )
+      cache_store(cache,&key,found_equilibria,passi);
+  }
+
+  if( verify == VERIFY_REFINE )
+    verify_eqlist(bimatrix,dim1,dim2,found_equilibria,1,0);
   
-  if(gambit_output) {
+  if(summary) {
+    int n = 0;
+    eqlist* l;
+    for( l = found_equilibria; l != 0; l = l->next )
+      n++;
+    fprintf(stdout,"%d %d\n",passi,n);
+    if( cache->fd >= 0 )
+      cache_print_stats(cache,stdout);
+  }
+  else if(gambit_output) {
     print_eqlist_gambit(found_equilibria,dim1,dim2,stdout);
   }
   else {
     print_eqlist(found_equilibria,stdout);
   }
 
-  free_tableaus(tableaus,dim1,dim2);
+  failed = verify ? verify_eqlist(bimatrix,dim1,dim2,found_equilibria,0,gambit_output || summary ? stderr : stdout) : 0;
+
+  if( memoized ) {
+    memo_print_stats(&memo,gambit_output || summary ? stderr : stdout);
+    memo_free(&memo);
+  }
+  if( sharded )
+    shard_print_stats(&shard,gambit_output || summary ? stderr : stdout);
+  if( sharded && shard.incomplete )
+    exit(1);
+
+  //unique is still -1 when the result came from the cache
+  if( engine == ENGINE_LP ) {
+    fprintf(gambit_output || summary ? stderr : stdout,
+	    "The game is constant-sum: its set of equilibria is convex%s\n",
+	    unique == 1 ? ", and the equilibrium above is the only one" : (unique == 0 ? ", and may contain more than the equilibrium above" : ""));
+  }
+
+  if( tableaus )
+    free_tableaus(tableaus,dim1,dim2);
+  if( sym_tableau )
+    free_symmetric_system(sym_tableau,dim1);
+  if( lp_tableau )
+    free_lp_system(lp_tableau,dim1);
+  if( ex_tableaus )
+    exact_free_systems(ex_tableaus);
   free_bimatrix(bimatrix,dim1,dim2);
   free_eqlist(found_equilibria);
+  return failed;
+}
+
+/*
+  Refines (when refine is 1) or checks the equilibria of the list, printing the regrets on f.
+  Returns the number of results that are not equilibria. The payoffs may have been positivized
+  already: this changes neither the regrets nor the solutions of the indifference equations.
+*/
+
+int verify_eqlist(double** bimatrix, int dim1, int dim2, eqlist* list, int refine, FILE* f) {
+  eq_check check;
+  int k = 0, ok, failed = 0;
+
+  for( ; list != 0; list = list->next ) {
+    k++;
+    if( refine ) {
+      refine_equilibrium(bimatrix,dim1,dim2,list->eq);
+      continue;
+    }
+    ok = check_equilibrium(bimatrix,dim1,dim2,list->eq,&check);
+    failed += !ok;
+    fprintf(f,"Equilibrium %d: ",k);
+    print_check(&check,ok,f);
+  }
+
+  return failed;
+}
+
+/*
+  Low memory mode: the tableaus were built by the streaming readers, so we only need to positivize them.
+  With all set we look for all equilibria, otherwise for the one of pivot. The output is the same of the
+  double engine.
+*/
+
+void lowmem_lemke_exec(double*** tableaus, int dim1, int dim2, int all, int pivot, double min, int gambit_output, int summary, int debug_mask, int outofcore) {
+  eqlist* found_equilibria = 0;
+  equilibrium* eq;
+  int passi = 0, n = 0;
+  eqlist* l;
+  lh_memo memo;
+
+  if( !all && (pivot <= 0 || pivot > (dim1+dim2)) ) {
+    fprintf(stderr,"Starting pivot must be a number between 1 and DIM1 + DIM2\n");
+    exit(1);
+  }
+
+  positivize_systems(tableaus,dim1,dim2,min);
+  if( outofcore )
+    ooc_attach(tableaus,dim1,dim2);
+
+  if( !all ) {
+    eq = lemke_howson_gen(tableaus,(double**)0,dim1,dim2,pivot,&passi,0,debug_mask);
+
+    if(summary)
+      fprintf(stdout,"%d %d\n",passi,eq_size(eq));
+    else if(gambit_output)
+      print_equilibrium_gambit(eq,dim1,dim2,stdout);
+    else
+      print_equilibrium(eq,stdout);
+    if(!summary)
+      fprintf(stdout,"Number of complementary pivoting steps performed by the algorithm: %d\n",passi);
+    if( outofcore ) {
+      ooc_print_stats(gambit_output || summary ? stderr : stdout);
+      ooc_detach();
+    }
+
+    free_equilibrium(eq);
+    return;
+  }
+
+  memo_init(&memo,dim1+dim2);
+  found_equilibria = all_lemke_gen(tableaus,(double**)0,dim1,dim2,-1,(eqlist*)0,&passi,&memo,debug_mask);
+
+  if(summary) {
+    for( l = found_equilibria; l != 0; l = l->next )
+      n++;
+    fprintf(stdout,"%d %d\n",passi,n);
+  }
+  else if(gambit_output)
+    print_eqlist_gambit(found_equilibria,dim1,dim2,stdout);
+  else
+    print_eqlist(found_equilibria,stdout);
+  memo_print_stats(&memo,gambit_output || summary ? stderr : stdout);
+  if( outofcore ) {
+    ooc_print_stats(gambit_output || summary ? stderr : stdout);
+    ooc_detach();
+  }
+
+  memo_free(&memo);
+  free_eqlist(found_equilibria);
+}
+
+/*
+  Batch mode. The games come from the seeded generator, one after the other, as the batch asks for them.
+  With serial set, they are solved one at a time by lemke_howson_gen: the default, as the lanes win only on some hosts.
+*/
+
+typedef struct batch_games_ {
+  int dim1, dim2;
+  unsigned long long seed, first;
+} batch_games;
+
+static double** batch_next_game(void* ctx, int k, double* min) {
+  batch_games* g = (batch_games*) ctx;
+  return get_random_bimatrix_seeded(g->dim1,g->dim2,g->seed,g->first + k,1,min);
+}
+
+void batch_lemke_exec(int dim1, int dim2, int pivot, int count, unsigned long long seed, unsigned long long first, int gambit_output, int summary, int serial) {
+  equilibrium** results = (equilibrium**) malloc(count * sizeof(equilibrium*));
+  int* steps = (int*) malloc(count * sizeof(int));
+  batch_games games = { dim1, dim2, seed, first };
+  struct timeval start, end;
+  double** bimatrix;
+  double*** tableaus;
+  double min, elapsed;
+  int k;
+
+  if( pivot <= 0 || pivot > (dim1+dim2) ) {
+    fprintf(stderr,"Starting pivot must be a number between 1 and DIM1 + DIM2\n");
+    exit(1);
+  }
+
+  gettimeofday(&start, NULL);
+  if( serial ) {
+    for(k = 0; k < count; k++) {
+      bimatrix = batch_next_game(&games,k,&min);
+      positivize_bimatrix(bimatrix,dim1,dim2,min);
+      tableaus = create_systems(bimatrix,dim1,dim2);
+      results[k] = lemke_howson_gen(tableaus,bimatrix,dim1,dim2,pivot,&steps[k],0,0);
+      free_tableaus(tableaus,dim1,dim2);
+      free_bimatrix(bimatrix,dim1,dim2);
+    }
+  }
+  else
+    batch_lemke_howson(batch_next_game,&games,count,dim1,dim2,pivot,results,steps);
+  gettimeofday(&end, NULL);
+
+  for(k = 0; k < count; k++) {
+    if(summary)
+      fprintf(stdout,"%d %d\n",steps[k],eq_size(results[k]));
+    else if(gambit_output)
+      print_equilibrium_gambit(results[k],dim1,dim2,stdout);
+    else {
+      fprintf(stdout,"Game %llu:\n",first + k);
+      print_equilibrium(results[k],stdout);
+    }
+    free_equilibrium(results[k]);
+  }
+
+  elapsed = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+  fprintf(stderr,"%d games in %.3lf seconds: %.0lf games/sec (%s)\n",count,elapsed,elapsed > 0.0 ? count / elapsed : 0.0,
+	  serial ? "one at a time" : "batched");
+
+  free(results);
+  free(steps);
+}
+
+/*
+  Daemon mode: the game of a request is solved with the engine single_lemke_exec or all_lemke_exec would
+  choose (pivot is 0 for all equilibria), and its equilibria written on out as with -G. The tableaus of the
+  double engine, the most common on the games sent to a daemon, come from the workspace of the connection.
+*/
+
+int daemon_solve(void* engine_option, daemon_workspace* ws, double** bimatrix, int dim1, int dim2, double min, int pivot, FILE* out, int* steps) {
+  exact_tableau** ex_tableaus;
+  double** sym_tableau;
+  double** lp_tableau;
+  double*** tableaus;
+  eqlist* list = 0;
+  eqlist* l;
+  equilibrium* eq;
+  const char* error;
+  cache_key key;
+  int engine, unique, found, n = 0;
+
+  *steps = 0;
+  if( pivot < 0 || pivot > (dim1+dim2) ) {
+    fprintf(out,"Starting pivot must be a number between 1 and DIM1 + DIM2, or 0 for all equilibria\n");
+    return -1;
+  }
+  engine = choose_engine(bimatrix,dim1,dim2,*(int*) engine_option,0,pivot == 0,&error);
+  if( engine < 0 ) {
+    fprintf(out,"%s\n",error);
+    return -1;
+  }
+
+  cache_make_key(&key,bimatrix,dim1,dim2,pivot,pivot == 0,engine);
+
+  if( !cache_lookup(ws->cache,&key,&list,steps) ) {
+    positivize_bimatrix(bimatrix,dim1,dim2,min);
+
+    if( engine == ENGINE_EXACT ) {
+      ex_tableaus = exact_create_systems(bimatrix,dim1,dim2);
+      if( pivot )
+	list = search_add_equilibrium(list,exact_lemke_howson(ex_tableaus,dim1,dim2,pivot,steps,0),&found);
+      else
+	list = exact_all_lemke(ex_tableaus,dim1,dim2,-1,(eqlist*)0,steps,0);
+      exact_free_systems(ex_tableaus);
+    }
+    else if( engine == ENGINE_SYMMETRIC ) {
+      sym_tableau = create_symmetric_system(bimatrix,dim1);
+      if( pivot )
+	list = search_add_equilibrium(list,lemke_howson_sym(sym_tableau,dim1,pivot > dim1 ? pivot - dim1 : pivot,steps,0),&found);
+      else
+	list = all_lemke_sym(sym_tableau,dim1,-1,(eqlist*)0,steps,0);
+      free_symmetric_system(sym_tableau,dim1);
+    }
+    else if( engine == ENGINE_LP ) {
+      lp_tableau = create_lp_system(bimatrix,dim1,dim2);
+      list = search_add_equilibrium(list,constant_sum_simplex(lp_tableau,dim1,dim2,steps,&unique,0),&found);
+      free_lp_system(lp_tableau,dim1);
+    }
+    else {
+      tableaus = workspace_systems(ws,bimatrix,dim1,dim2);
+      if( pivot ) {
+	eq = lemke_howson_gen(tableaus,bimatrix,dim1,dim2,pivot,steps,0,0);
+	list = search_add_equilibrium(list,eq,&found);
+      }
+      else
+	list = all_lemke_gen(tableaus,bimatrix,dim1,dim2,-1,(eqlist*)0,steps,(lh_memo*)0,0);
+    }
+
+    cache_store(ws->cache,&key,list,*steps);
+  }
+
+  for( l = list; l != 0; l = l->next )
+    n++;
+  print_eqlist_gambit(list,dim1,dim2,out);
+  free_eqlist(list);
+
+  return n;
 }
@@ -0,0 +1,215 @@
+/*
+  Out-of-core pivoting kernels.
+
+  The summaries are updated by the elimination itself. A row that is updated gets row + c * prow,
+  so its new nonzero coefficients are among its old ones and those of the pivot row: the summary
+  of each block visited gains the nonzero columns of the pivot row. The pivot column is set to
+  zero in every updated row, so its bit is cleared unless a row of the block kept a coefficient
+  (one below eps, that the elimination leaves where it is). Bits are never cleared otherwise, so
+  a summary may claim nonzeros that cancelled out: that only costs a block read for nothing.
+
+  The hints to the kernel are madvise(MADV_WILLNEED) on the next block to visit, a single call for
+  the whole block. The ratio test reads only two coefficients of each row, but the elimination that
+  follows visits the same blocks, in full: reading them ahead already in the ratio test costs
+  nothing more, and one call per row would cost more than the pivot on tableaus in memory.
+*/
+
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "ooc.h"
+
+static ooc_tableau attached[2];
+static int nattached = 0;
+
+static inline void set_bit(uint64_t* s, int j) {
+  s[j >> 6] |= 1ULL << (j & 63);
+}
+
+static inline void clear_bit(uint64_t* s, int j) {
+  s[j >> 6] &= ~(1ULL << (j & 63));
+}
+
+static inline int get_bit(const uint64_t* s, int j) {
+  return (s[j >> 6] >> (j & 63)) & 1;
+}
+
+//Asks the kernel to read the bytes from start to end, widened to whole pages
+static void prefetch(const void* start, const void* end) {
+  static long page = 0;
+  uintptr_t first, last;
+
+  if( !page )
+    page = sysconf(_SC_PAGESIZE);
+  first = (uintptr_t) start & ~(uintptr_t) (page - 1);
+  last = (uintptr_t) end;
+  madvise((void*) first, last - first, MADV_WILLNEED);
+}
+
+static inline int block_first(ooc_tableau* ot, int b) {
+  return b * ot->block_rows;
+}
+
+static inline int block_last(ooc_tableau* ot, int b) {
+  return (b + 1) * ot->block_rows < ot->nlines ? (b + 1) * ot->block_rows : ot->nlines;
+}
+
+//Asks the kernel to read the rows of block b
+static void prefetch_block(ooc_tableau* ot, int b) {
+  prefetch(ot->rows[block_first(ot,b)],ot->rows[block_last(ot,b) - 1] + ot->width);
+}
+
+//First block after b that may have a nonzero coefficient in the column (nblocks if there is none)
+static int next_block(ooc_tableau* ot, int b, int column) {
+  for(b++; b < ot->nblocks; b++) {
+    if( get_bit(ot->summary + (long) b * ot->words, column) )
+      return b;
+  }
+  return b;
+}
+
+static void summarize_block(ooc_tableau* ot, int b) {
+  uint64_t* s = ot->summary + (long) b * ot->words;
+  int i, j;
+
+  for(i = block_first(ot,b); i < block_last(ot,b); i++) {
+    for(j = 1; j < ot->width; j++) {
+      if( ot->rows[i][j] != 0.0 )
+	set_bit(s,j);
+    }
+  }
+}
+
+static void attach_tableau(ooc_tableau* ot, double** tableau, int nlines, int width) {
+  int b;
+
+  ot->rows = tableau;
+  ot->nlines = nlines;
+  ot->width = width;
+  ot->block_rows = OOC_BLOCK_BYTES / (width * (int) sizeof(double));
+  ot->block_rows = ot->block_rows > 0 ? ot->block_rows : 1;
+  ot->nblocks = (nlines + ot->block_rows - 1) / ot->block_rows;
+  ot->words = (width + 63) / 64;
+  ot->summary = (uint64_t*) calloc((long) ot->nblocks * ot->words, sizeof(uint64_t));
+  ot->prow = (uint64_t*) malloc(ot->words * sizeof(uint64_t));
+  ot->visited = 0;
+  ot->skipped = 0;
+
+  for(b = 0; b < ot->nblocks; b++) {
+    if( b + 1 < ot->nblocks )
+      prefetch_block(ot,b + 1);
+    summarize_block(ot,b);
+  }
+}
+
+void ooc_attach(double*** tableaus, int dim1, int dim2) {
+  attach_tableau(&attached[0],tableaus[0],dim1,2 + dim1 + dim2);
+  attach_tableau(&attached[1],tableaus[1],dim2,2 + dim1 + dim2);
+  nattached = 2;
+}
+
+void ooc_detach(void) {
+  int t;
+
+  for(t = 0; t < nattached; t++) {
+    free(attached[t].summary);
+    free(attached[t].prow);
+  }
+  nattached = 0;
+}
+
+ooc_tableau* ooc_find(double** tableau) {
+  int t;
+
+  for(t = 0; t < nattached; t++) {
+    if( attached[t].rows == tableau )
+      return &attached[t];
+  }
+  return 0;
+}
+
+int ooc_min_ratio_row(ooc_tableau* ot, int column) {
+  int b, nb, i, index = -1, n = 0;
+  double min = 0.0, val;
+
+  for(b = next_block(ot,-1,column); b < ot->nblocks; b = nb) {
+    nb = next_block(ot,b,column);
+    if( nb < ot->nblocks )
+      prefetch_block(ot,nb);
+    n++;
+
+    for(i = block_first(ot,b); i < block_last(ot,b); i++) {
+      if( ot->rows[i][column] > -eps )
+	continue;
+      val = -ot->rows[i][1] / ot->rows[i][column];
+      if( index < 0 || val<(min-eps)) {
+	min = val;
+	index = i;
+      }
+    }
+  }
+
+  ot->visited += n;
+  ot->skipped += ot->nblocks - n;
+  return index;
+}
+
+void ooc_pivot_rows(ooc_tableau* ot, int index, int column) {
+  double* prow = ot->rows[index];
+  uint64_t* s;
+  int b, nb, i, j, w, kept, updated, n = 0;
+  int pb = index / ot->block_rows;
+  double agg;
+
+  memset(ot->prow, 0, ot->words * sizeof(uint64_t));
+  for(j = 1; j < ot->width; j++) {
+    if( prow[j] != 0.0 )
+      set_bit(ot->prow,j);
+  }
+
+  //The block of the pivot row is always visited: the row changed, and its summary must follow
+  for(b = pb < next_block(ot,-1,column) ? pb : next_block(ot,-1,column); b < ot->nblocks; b = nb) {
+    nb = next_block(ot,b,column);
+    nb = b < pb && pb < nb ? pb : nb;
+    if( nb < ot->nblocks )
+      prefetch_block(ot,nb);
+    n++;
+
+    kept = 0;
+    updated = b == pb;
+    for(i = block_first(ot,b); i < block_last(ot,b); i++) {
+      if (ot->rows[i][column] < -eps || ot->rows[i][column] > eps) {
+	for (j = 1; j < ot->width; j++) {
+	  agg = ot->rows[i][column] * prow[j];
+	  ot->rows[i][j] += agg;
+	}
+	ot->rows[i][column] = 0;
+	updated = 1;
+      }
+      else
+	kept |= ot->rows[i][column] != 0.0;
+    }
+
+    s = ot->summary + (long) b * ot->words;
+    if( updated ) {
+      for(w = 0; w < ot->words; w++)
+	s[w] |= ot->prow[w];
+    }
+    if( !kept )
+      clear_bit(s,column);
+  }
+
+  ot->visited += n;
+  ot->skipped += ot->nblocks - n;
+}
+
+void ooc_print_stats(FILE* f) {
+  long visited = 0, total = 0;
+  int t;
+
+  for(t = 0; t < nattached; t++) {
+    visited += attached[t].visited;
+    total += attached[t].visited + attached[t].skipped;
+  }
+  fprintf(f,"Out-of-core tableaus: %ld blocks read, %ld skipped by the column summaries\n",visited,total - visited);
+}
@@ -0,0 +1,48 @@
+#ifndef OOC_H
+#define OOC_H
+
+#include "bimatrix.h"
+
+/*
+  Out-of-core tableaus, for games whose tableaus don't fit in memory. The arena of the tableaus is
+  mapped on a file (see set_tableau_file), so the kernel pages the rows in and out as the pivots use
+  them. The rows of each tableau are grouped in blocks of about OOC_BLOCK_BYTES, and for each block
+  we keep in memory a summary: one bit per column, set if some row of the block may have a nonzero
+  coefficient there. The ratio test and the elimination visit only the blocks whose bit is set in
+  the pivot column, so the rows with a zero coefficient are never paged in, and while a block is
+  processed the next one to visit is prefetched.
+
+  A cleared bit means that all the coefficients of the block in that column are exactly zero: those
+  rows are the ones the in-memory kernels would skip, so the results are the same bit by bit.
+*/
+
+//Size of a block of rows (a block holds at least one row)
+#define OOC_BLOCK_BYTES (1 << 20)
+
+typedef struct ooc_tableau_ {
+  double** rows;       //The tableau, as passed to the pivoting kernels
+  int nlines, width;
+  int block_rows;      //Rows per block
+  int nblocks;
+  int words;           //64 bit words of the summary of a block
+  uint64_t* summary;   //Bit j of the summary of block b: some row of b may have a nonzero coefficient in column j
+  uint64_t* prow;      //Nonzero columns of the pivot row, during a pivot
+  long visited;        //Blocks read by the kernels
+  long skipped;        //Blocks skipped thanks to the summaries
+} ooc_tableau;
+
+//Builds the summaries of the two tableaus, reading them once. From then on the pivoting kernels use them
+void ooc_attach(double*** tableaus, int dim1, int dim2);
+void ooc_detach(void);
+
+//The summaries of the tableau, or NULL if it is not attached
+ooc_tableau* ooc_find(double** tableau);
+
+//Same as the serial loops of min_ratio_row and pivot_tableau (the pivot row already normalized), on the blocks in the summaries
+int ooc_min_ratio_row(ooc_tableau* ot, int column);
+void ooc_pivot_rows(ooc_tableau* ot, int index, int column);
+
+//Prints the number of blocks read and skipped by the kernels
+void ooc_print_stats(FILE* f);
+
+#endif
@@ -0,0 +1,138 @@
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "philox.h"
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+
+/*
+  Computes the blocks of PHILOX_LANES consecutive counters. The counter of a block is its index in
+  the first two words and the game index in the last two, the key is the seed. Every block gives
+  two 64 bit outputs, hence two payoffs.
+*/
+
+static void philox_lanes(uint64_t block, uint64_t seed, uint64_t game, uint64_t* out) {
+  uint32_t c0[PHILOX_LANES], c1[PHILOX_LANES], c2[PHILOX_LANES], c3[PHILOX_LANES];
+  uint32_t k0 = (uint32_t) seed, k1 = (uint32_t) (seed >> 32);
+  uint64_t p0, p1;
+  int l, r;
+
+  for(l = 0; l < PHILOX_LANES; l++) {
+    c0[l] = (uint32_t) (block + l);
+    c1[l] = (uint32_t) ((block + l) >> 32);
+    c2[l] = (uint32_t) game;
+    c3[l] = (uint32_t) (game >> 32);
+  }
+
+  for(r = 0; r < 10; r++) {
+    for(l = 0; l < PHILOX_LANES; l++) {
+      p0 = (uint64_t) PHILOX_M0 * c0[l];
+      p1 = (uint64_t) PHILOX_M1 * c2[l];
+      c0[l] = (uint32_t) (p1 >> 32) ^ c1[l] ^ k0;
+      c2[l] = (uint32_t) (p0 >> 32) ^ c3[l] ^ k1;
+      c1[l] = (uint32_t) p1;
+      c3[l] = (uint32_t) p0;
+    }
+    k0 += PHILOX_W0;
+    k1 += PHILOX_W1;
+  }
+
+  for(l = 0; l < PHILOX_LANES; l++) {
+    out[2 * l] = ((uint64_t) c1[l] << 32) | c0[l];
+    out[2 * l + 1] = ((uint64_t) c3[l] << 32) | c2[l];
+  }
+}
+
+//The 53 most significant bits give a uniform double in [0,1), which we map to [-1,1) as the old generator did
+static inline double philox_to_double(uint64_t x) {
+  return 2.0 * ((double) (x >> 11) * (1.0 / 9007199254740992.0)) - 1.0;
+}
+
+void philox_fill(double* out, long n, uint64_t seed, uint64_t game, uint64_t first) {
+  uint64_t buf[2 * PHILOX_LANES];
+  uint64_t block = first / (2 * PHILOX_LANES) * PHILOX_LANES;
+  long skip = first % (2 * PHILOX_LANES);
+  long k = 0;
+  int l;
+
+  while( k < n ) {
+    philox_lanes(block,seed,game,buf);
+    for(l = skip; l < 2 * PHILOX_LANES && k < n; l++)
+      out[k++] = philox_to_double(buf[l]);
+    skip = 0;
+    block += PHILOX_LANES;
+  }
+}
+
+typedef struct philox_job_ {
+  double* out;
+  long n;
+  uint64_t first;
+  uint64_t seed;
+  uint64_t game;
+  double min;
+} philox_job;
+
+static void* philox_worker(void* arg) {
+  philox_job* job = (philox_job*) arg;
+  long k;
+
+  philox_fill(job->out,job->n,job->seed,job->game,job->first);
+
+  job->min = 1.0;
+  for(k = 0; k < job->n; k++)
+    job->min = job->out[k] < job->min ? job->out[k] : job->min;
+
+  return 0;
+}
+
+/*
+  The payoffs are split in contiguous chunks, aligned to whole vectors of blocks. The chunks only
+  change which thread computes an element, not its value.
+*/
+
+double philox_fill_parallel(double* out, long n, uint64_t seed, uint64_t game, int threads) {
+  philox_job* jobs;
+  pthread_t* tids;
+  long chunk, start;
+  double min = 1.0;
+  int t, nt;
+
+  if( threads <= 0 )
+    threads = n < PHILOX_PARALLEL_MIN ? 1 : (int) sysconf(_SC_NPROCESSORS_ONLN);
+  if( threads < 1 )
+    threads = 1;
+
+  chunk = (n + threads - 1) / threads;
+  chunk = (chunk + 2 * PHILOX_LANES - 1) / (2 * PHILOX_LANES) * (2 * PHILOX_LANES);
+
+  jobs = (philox_job*) malloc(threads * sizeof(philox_job));
+  tids = (pthread_t*) malloc(threads * sizeof(pthread_t));
+
+  for(nt = 0, start = 0; start < n; nt++, start += chunk) {
+    jobs[nt].out = out + start;
+    jobs[nt].n = (n - start) < chunk ? (n - start) : chunk;
+    jobs[nt].first = start;
+    jobs[nt].seed = seed;
+    jobs[nt].game = game;
+  }
+
+  //The first chunk is done by the calling thread
+  for(t = 1; t < nt; t++)
+    pthread_create(&tids[t],0,philox_worker,&jobs[t]);
+  if( nt > 0 )
+    philox_worker(&jobs[0]);
+  for(t = 1; t < nt; t++)
+    pthread_join(tids[t],0);
+
+  for(t = 0; t < nt; t++)
+    min = jobs[t].min < min ? jobs[t].min : min;
+
+  free(jobs);
+  free(tids);
+  return min;
+}
@@ -0,0 +1,25 @@
+#ifndef PHILOX_H
+#define PHILOX_H
+
+#include <stdint.h>
+
+/*
+  Philox4x32-10 counter-based pseudo-random generator (Salmon et al., "Parallel random numbers:
+  as easy as 1, 2, 3"). Each output block is a pure function of a 128 bit counter and a 64 bit key,
+  so any element of a random game can be computed independently: the games are reproducible from
+  (seed, game index) whatever the number of threads that generates them.
+*/
+
+//Number of counters processed together by philox_fill, so that the compiler can vectorize the rounds
+#define PHILOX_LANES 8
+
+//Games bigger than this (number of payoffs) are generated in parallel when the thread count is automatic
+#define PHILOX_PARALLEL_MIN (1 << 18)
+
+//Fills out[0..n-1] with uniform doubles in [-1,1), element k being a function of (seed, game, first + k) only
+void philox_fill(double* out, long n, uint64_t seed, uint64_t game, uint64_t first);
+
+//Same as philox_fill, splitting the work among threads (0 means one per online processor). Returns the minimum value
+double philox_fill_parallel(double* out, long n, uint64_t seed, uint64_t game, int threads);
+
+#endif
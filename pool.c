@@ -0,0 +1,136 @@
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+#include "pool.h"
+
+struct thread_pool_ {
+  int nthreads;
+  pthread_t* tids;
+  struct pool_worker_* workers;
+
+  //A new job is published by incrementing generation, and each worker decrements pending when done
+  atomic_uint generation;
+  atomic_int pending;
+  atomic_int quit;
+  void (*job)(void*, int, int);
+  void* arg;
+
+  //Workers that waited too long sleep on the condition variable, and pool_run wakes them
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  atomic_int sleepers;
+};
+
+typedef struct pool_worker_ {
+  thread_pool* pool;
+  int t;
+} pool_worker;
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
+
+static void* pool_worker_loop(void* arg) {
+  pool_worker* w = (pool_worker*) arg;
+  thread_pool* pool = w->pool;
+  unsigned int seen = 0;
+  int spin;
+
+  for(;;) {
+    for(spin = 0; atomic_load_explicit(&pool->generation, memory_order_acquire) == seen; spin++) {
+      if( spin < POOL_SPIN )
+	cpu_relax();
+      else if( spin < POOL_SPIN + POOL_YIELD )
+	sched_yield();
+      else {
+	//Nothing to do for a while (the program is not pivoting): we stop using the processor
+	pthread_mutex_lock(&pool->lock);
+	atomic_fetch_add(&pool->sleepers, 1);
+	while( atomic_load(&pool->generation) == seen )
+	  pthread_cond_wait(&pool->wake, &pool->lock);
+	atomic_fetch_sub(&pool->sleepers, 1);
+	pthread_mutex_unlock(&pool->lock);
+      }
+    }
+    seen++;
+
+    if( atomic_load(&pool->quit) )
+      return 0;
+
+    pool->job(pool->arg, w->t, pool->nthreads);
+    atomic_fetch_sub_explicit(&pool->pending, 1, memory_order_release);
+  }
+}
+
+thread_pool* pool_create(int nthreads) {
+  int t;
+  thread_pool* pool = (thread_pool*) malloc(sizeof(thread_pool));
+
+  pool->nthreads = nthreads < 1 ? 1 : nthreads;
+  pool->tids = (pthread_t*) malloc(pool->nthreads * sizeof(pthread_t));
+  pool->workers = (pool_worker*) malloc(pool->nthreads * sizeof(pool_worker));
+  atomic_init(&pool->generation, 0);
+  atomic_init(&pool->pending, 0);
+  atomic_init(&pool->quit, 0);
+  atomic_init(&pool->sleepers, 0);
+  pthread_mutex_init(&pool->lock, 0);
+  pthread_cond_init(&pool->wake, 0);
+
+  for(t = 1; t < pool->nthreads; t++) {
+    pool->workers[t].pool = pool;
+    pool->workers[t].t = t;
+    pthread_create(&pool->tids[t], 0, pool_worker_loop, &pool->workers[t]);
+  }
+
+  return pool;
+}
+
+void pool_run(thread_pool* pool, void (*job)(void*, int, int), void* arg) {
+  int spin;
+
+  pool->job = job;
+  pool->arg = arg;
+  atomic_store_explicit(&pool->pending, pool->nthreads - 1, memory_order_relaxed);
+  atomic_fetch_add(&pool->generation, 1);
+
+  if( atomic_load(&pool->sleepers) > 0 ) {
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+  }
+
+  job(arg, 0, pool->nthreads);
+
+  for(spin = 0; atomic_load_explicit(&pool->pending, memory_order_acquire) > 0; spin++) {
+    if( spin < POOL_SPIN )
+      cpu_relax();
+    else
+      sched_yield();
+  }
+}
+
+int pool_size(thread_pool* pool) {
+  return pool->nthreads;
+}
+
+void pool_free(thread_pool* pool) {
+  int t;
+
+  atomic_store(&pool->quit, 1);
+  atomic_fetch_add(&pool->generation, 1);
+  pthread_mutex_lock(&pool->lock);
+  pthread_cond_broadcast(&pool->wake);
+  pthread_mutex_unlock(&pool->lock);
+  for(t = 1; t < pool->nthreads; t++)
+    pthread_join(pool->tids[t], 0);
+
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->wake);
+  free(pool->tids);
+  free(pool->workers);
+  free(pool);
+}
@@ -0,0 +1,32 @@
+#ifndef POOL_H
+#define POOL_H
+
+/*
+  Persistent thread pool used to split the work of a single pivoting step. A pivot takes from some
+  microseconds to some milliseconds, so the threads are created once and then wait for work spinning
+  on a counter: starting and joining threads, or sleeping on a condition variable, would cost more
+  than the pivot itself. Only the threads that found no work for a long time go to sleep.
+*/
+
+typedef struct thread_pool_ thread_pool;
+
+//Maximum number of threads of a pool
+#define POOL_MAX_THREADS 256
+
+//Iterations of busy waiting before a waiting thread starts yielding the processor
+#define POOL_SPIN 4096
+
+//Yields of the processor before a waiting thread goes to sleep
+#define POOL_YIELD 1024
+
+//Creates a pool of nthreads threads, the calling one included
+thread_pool* pool_create(int nthreads);
+
+//Runs job(arg, t, nthreads) on every thread t of the pool (t = 0 is the caller), and returns when all of them are done
+void pool_run(thread_pool* pool, void (*job)(void* arg, int t, int nthreads), void* arg);
+
+int pool_size(thread_pool* pool);
+
+void pool_free(thread_pool* pool);
+
+#endif
@@ -0,0 +1,32 @@
+#!/bin/sh
+# Regression check of the memoization of the paths: the payoffs of a random game are multiplied by
+# several factors, and the equilibria found with -a and the number of paths avoided must stay the same,
+# since scaling the payoffs changes neither the equilibria nor the ties of the ratio tests.
+# Usage: ./scale_check.sh [./lemkehowson [DIM [SEED]]]
+
+LH=${1:-./lemkehowson}
+DIM=${2:-15}
+SEED=${3:-11}
+DIR=$(mktemp -d) || exit 1
+trap 'rm -rf "$DIR"' EXIT
+
+"$LH" -w "$DIM" -l "$DIM" -r "$SEED" -o "$DIR/g.nfg" || exit 1
+"$LH" -i "$DIR/g.nfg" -a -G -e double > "$DIR/g.out" 2> "$DIR/g.err" || exit 1
+grep "Path endpoints" "$DIR/g.err" > "$DIR/g.memo"
+
+status=0
+for k in 1e-3 1000 1e6; do
+  awk -v k="$k" 'NR <= 3 { print; next } { for(i = 1; i <= NF; i++) printf "%.17g ", $i * k; print "" }' \
+    "$DIR/g.nfg" > "$DIR/s.nfg"
+  "$LH" -i "$DIR/s.nfg" -a -G -e double > "$DIR/s.out" 2> "$DIR/s.err" || exit 1
+  if ! cmp -s "$DIR/g.out" "$DIR/s.out"; then
+    echo "payoffs times $k: the equilibria differ"
+    status=1
+  fi
+  if ! grep "Path endpoints" "$DIR/s.err" | cmp -s "$DIR/g.memo" -; then
+    echo "payoffs times $k: $(grep "Path endpoints" "$DIR/s.err") instead of $(cat "$DIR/g.memo")"
+    status=1
+  fi
+done
+[ $status -eq 0 ] && echo "scale check passed: $(cat "$DIR/g.memo")"
+exit $status
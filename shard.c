@@ -0,0 +1,642 @@
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include "shard.h"
+
+//States of a slot of the table, besides the pid of the worker writing it
+#define SLOT_EMPTY 0
+#define SLOT_FULL -1
+
+/*
+  Layout of the shared memory: the header, the payoffs (on their own pages, protected read-only in the
+  workers), and the table. Each slot has a fixed header followed by the support of the equilibrium as a
+  bitset (the key), the labels in basis of the rows of the two tableaus, and the strategies of the
+  equilibrium with their probabilities, in the order of the list.
+*/
+
+typedef struct shard_shared_ {
+  int dim1, dim2;
+  int nlabels;
+  int words;           //64 bit words of a key
+  long nslots;
+  long slot_bytes;
+  long payoffs;        //Offset of the payoffs
+  long table;          //Offset of the table
+} shard_shared;
+
+typedef struct shard_slot_ {
+  atomic_int state;    //SLOT_EMPTY, SLOT_FULL, or the pid of the worker writing it
+  int size;            //Strategies in the support
+  uint64_t hash;
+} shard_slot;
+
+typedef struct shard_task_ {
+  int slot;            //Equilibrium the path leaves (-1 for the artificial one)
+  int label;
+  int retries;
+} shard_task;
+
+typedef struct shard_result_ {
+  int slot;            //Equilibrium at the end of the path (-1 for the artificial one, -2 if the table is full)
+  int steps;
+  int rebuild;
+  int degenerate;      //A ratio test of the path had a tie: it cannot be walked back
+} shard_result;
+
+typedef struct shard_worker_ {
+  pid_t pid;
+  int fd;
+  int busy;
+  int at;              //Equilibrium at which the tableaus of the worker are (-1 for the artificial one, -2 for none)
+  shard_task task;
+} shard_worker;
+
+static inline shard_slot* get_slot(shard_shared* sh, long s) {
+  return (shard_slot*) ((char*) sh + sh->table + s * sh->slot_bytes);
+}
+
+static inline uint64_t* slot_key(shard_shared* sh, shard_slot* slot) {
+  (void) sh;
+  return (uint64_t*) (slot + 1);
+}
+
+static inline int* slot_basis(shard_shared* sh, shard_slot* slot) {
+  return (int*) (slot_key(sh,slot) + sh->words);
+}
+
+static inline int* slot_labels(shard_shared* sh, shard_slot* slot) {
+  return slot_basis(sh,slot) + sh->nlabels;
+}
+
+static inline double* slot_probs(shard_shared* sh, shard_slot* slot) {
+  return (double*) (slot_labels(sh,slot) + sh->nlabels);
+}
+
+static int read_full(int fd, void* buf, size_t len) {
+  size_t done = 0;
+  ssize_t n;
+
+  while( done < len ) {
+    n = read(fd, (char*) buf + done, len - done);
+    if( n < 0 && errno == EINTR )
+      continue;
+    if( n <= 0 )
+      return -1;
+    done += n;
+  }
+  return 0;
+}
+
+static int write_full(int fd, const void* buf, size_t len) {
+  size_t done = 0;
+  ssize_t n;
+
+  while( done < len ) {
+    n = write(fd, (const char*) buf + done, len - done);
+    if( n < 0 && errno == EINTR )
+      continue;
+    if( n <= 0 )
+      return -1;
+    done += n;
+  }
+  return 0;
+}
+
+static double now(void) {
+  struct timeval tv;
+
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+/*
+  Workers.
+*/
+
+//Puts in key the support of the equilibrium, and returns its hash
+static uint64_t make_key(equilibrium* eq, uint64_t* key, int words) {
+  uint64_t h = 0x9e3779b97f4a7c15ULL;
+  int w;
+
+  memset(key, 0, words * sizeof(uint64_t));
+  for( ; eq != 0; eq = eq->next )
+    key[(eq->label - 1) >> 6] |= 1ULL << ((eq->label - 1) & 63);
+  for(w = 0; w < words; w++) {
+    h ^= key[w];
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+  }
+  return h;
+}
+
+static void write_slot(shard_shared* sh, shard_slot* slot, uint64_t h, uint64_t* key, equilibrium* eq, double*** tableaus) {
+  int i;
+
+  slot->hash = h;
+  memcpy(slot_key(sh,slot), key, sh->words * sizeof(uint64_t));
+  for(i = 0; i < sh->dim1; i++)
+    slot_basis(sh,slot)[i] = (int) tableaus[0][i][0];
+  for(i = 0; i < sh->dim2; i++)
+    slot_basis(sh,slot)[sh->dim1 + i] = (int) tableaus[1][i][0];
+  for(slot->size = 0; eq != 0; eq = eq->next, slot->size++) {
+    slot_labels(sh,slot)[slot->size] = eq->label;
+    slot_probs(sh,slot)[slot->size] = eq->prob;
+  }
+}
+
+/*
+  Finds the equilibrium in the table, adding it if it is not there. Returns its slot, or -1 if the table
+  is full. A worker that finds a slot being written waits for it to be published, but if its writer died
+  it claims the slot in turn: the equilibrium of the dead worker will be added again when its task is.
+*/
+static long find_add_slot(shard_shared* sh, equilibrium* eq, double*** tableaus, uint64_t* key) {
+  uint64_t h = make_key(eq,key,sh->words);
+  long s = h & (sh->nslots - 1), probes;
+  int state, spin, self = (int) getpid();
+  shard_slot* slot;
+
+  for(probes = 0; probes < sh->nslots; probes++, s = (s + 1) & (sh->nslots - 1)) {
+    slot = get_slot(sh,s);
+    for(spin = 1; ; spin++) {
+      state = atomic_load_explicit(&slot->state, memory_order_acquire);
+      if( state == SLOT_FULL )
+	break;
+      if( (state == SLOT_EMPTY || (spin % SHARD_SPIN_CHECK == 0 && kill(state, 0) < 0 && errno == ESRCH)) &&
+	  atomic_compare_exchange_strong(&slot->state, &state, self) ) {
+	write_slot(sh,slot,h,key,eq,tableaus);
+	atomic_store_explicit(&slot->state, SLOT_FULL, memory_order_release);
+	return s;
+      }
+    }
+    if( slot->hash == h && memcmp(slot_key(sh,slot), key, sh->words * sizeof(uint64_t)) == 0 )
+      return s;
+  }
+  return -1;
+}
+
+/*
+  Brings the tableaus from the slack basis to the basis of the equilibrium, with a Gauss-Jordan
+  elimination: each label of the basis that is not in yet enters in the row, among those of labels
+  leaving, with the largest coefficient. Returns the number of pivots, or -1 if the basis is singular:
+  on degenerate games a path can pivot on a coefficient that is only rounding, and end at such a basis.
+*/
+static int rebuild_basis(double*** tableaus, int dim1, int dim2, const int* basis) {
+  int t, k, i, nlines, column, best, leaving, pivots = 0;
+  const int* want;
+  double** tab;
+
+  for(t = 0; t < 2; t++) {
+    tab = tableaus[t];
+    nlines = t == 0 ? dim1 : dim2;
+    want = basis + (t == 0 ? 0 : dim1);
+
+    for(k = 0; k < nlines; k++) {
+      for(i = 0; i < nlines && (int) tab[i][0] != want[k]; i++);
+      if( i < nlines )
+	continue;
+
+      column = get_column(dim1,dim2,want[k]);
+      best = -1;
+      for(i = 0; i < nlines; i++) {
+	for(leaving = 0; leaving < nlines && want[leaving] != (int) tab[i][0]; leaving++);
+	if( leaving == nlines && (best < 0 || fabs(tab[i][column]) > fabs(tab[best][column])) )
+	  best = i;
+      }
+      if( fabs(tab[best][column]) <= eps )
+	return -1;
+      leaving = (int) tab[best][0];
+      pivot_tableau(tab,nlines,dim1 + dim2 + 2,best,column,get_column(dim1,dim2,leaving),want[k]);
+      pivots++;
+    }
+  }
+  return pivots;
+}
+
+static void worker_loop(shard_shared* sh, int fd, int debug) {
+  int dim1 = sh->dim1, dim2 = sh->dim2, i;
+  double* payoffs = (double*) ((char*) sh + sh->payoffs);
+  double** bimatrix = (double**) malloc(2 * dim1 * sizeof(double*));
+  double*** tableaus = alloc_tableaus(dim1,dim2);
+  uint64_t* key = (uint64_t*) malloc(sh->words * sizeof(uint64_t));
+  equilibrium* eq;
+  shard_result res;
+  shard_task task;
+  int at = -1;
+  long s;
+
+  mprotect((char*) sh + sh->payoffs, sh->table - sh->payoffs, PROT_READ);
+  for(i = 0; i < 2 * dim1; i++)
+    bimatrix[i] = payoffs + (long) i * dim2;
+
+  //The tableaus stay at the end of the last path: a path leaving from there needs no rebuild
+  load_systems(tableaus,bimatrix,dim1,dim2);
+  while( read_full(fd, &task, sizeof(task)) == 0 ) {
+    res.rebuild = 0;
+    if( task.slot != at ) {
+      load_systems(tableaus,bimatrix,dim1,dim2);
+      res.rebuild = task.slot >= 0 ? rebuild_basis(tableaus,dim1,dim2,slot_basis(sh,get_slot(sh,task.slot))) : 0;
+    }
+    if( res.rebuild < 0 ) { //A singular basis: the path is abandoned, as one that cycles
+      res.rebuild = 0;
+      res.steps = 0;
+      res.degenerate = 2;
+      eq = 0;
+    }
+    else
+      eq = lemke_howson_gen(tableaus,bimatrix,dim1,dim2,task.label,&res.steps,&res.degenerate,debug);
+
+    s = is_artificial(eq) ? -1 : find_add_slot(sh,eq,tableaus,key);
+    res.slot = s < 0 && !is_artificial(eq) ? -2 : (int) s;
+    /*
+      After a tie the tableaus can be at another basis of the equilibrium than the one in its slot, or at
+      the same one with a zero rounded below zero: the next path leaves from the basis in the slot.
+    */
+    at = res.degenerate ? -2 : res.slot;
+    free_equilibrium(eq);
+    if( write_full(fd, &res, sizeof(res)) < 0 )
+      break;
+  }
+}
+
+/*
+  Coordinator.
+*/
+
+static int start_worker(shard_shared* sh, shard_worker* workers, int nworkers, int w, int debug) {
+  int fds[2], k;
+
+  if( socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0 )
+    return -1;
+  fflush(stdout);
+  fflush(stderr);
+
+  workers[w].pid = fork();
+  if( workers[w].pid < 0 ) {
+    close(fds[0]);
+    close(fds[1]);
+    return -1;
+  }
+  if( workers[w].pid == 0 ) {
+    //The sockets of the other workers must be closed here, or they would not see the end of their tasks
+    for(k = 0; k < nworkers; k++) {
+      if( k != w && workers[k].fd >= 0 )
+	close(workers[k].fd);
+    }
+    close(fds[0]);
+    worker_loop(sh,fds[1],debug);
+    _exit(0);
+  }
+
+  close(fds[1]);
+  workers[w].fd = fds[0];
+  workers[w].busy = 0;
+  workers[w].at = -1;
+  return 0;
+}
+
+static void stop_worker(shard_worker* worker) {
+  close(worker->fd);
+  worker->fd = -1;
+  waitpid(worker->pid, NULL, 0);
+}
+
+/*
+  known[s + 1][label] tells, for the equilibrium in slot s (or the artificial one, for s = -1), whether
+  the path with that label is still to walk (0), in the queue (1), or walked from one of its ends (2).
+  It is allocated when the equilibrium is found, and its tasks are pushed in reverse order, so that they
+  are sent from the lowest label, as all_lemke_gen walks them.
+*/
+
+typedef struct shard_queue_ {
+  shard_task* tasks;
+  long count, size;
+  unsigned char** known;
+  int nlabels;
+  long found;          //Equilibria in the table
+} shard_queue;
+
+static void push_task(shard_queue* q, int slot, int label, int retries) {
+  if( q->count == q->size ) {
+    q->size = q->size ? 2 * q->size : 1024;
+    q->tasks = (shard_task*) realloc(q->tasks, q->size * sizeof(shard_task));
+  }
+  q->tasks[q->count].slot = slot;
+  q->tasks[q->count].label = label;
+  q->tasks[q->count].retries = retries;
+  q->count++;
+}
+
+//Moves on top of the queue a task leaving from the equilibrium at, if there is one among the last SHARD_AFFINITY
+static void prefer(shard_queue* q, int at) {
+  shard_task task;
+  long k;
+
+  for(k = q->count - 1; k >= 0 && k >= q->count - SHARD_AFFINITY; k--) {
+    if( q->tasks[k].slot == at ) {
+      task = q->tasks[k];
+      q->tasks[k] = q->tasks[q->count - 1];
+      q->tasks[q->count - 1] = task;
+      return;
+    }
+  }
+}
+
+static void expand(shard_queue* q, int slot, int taboo) {
+  unsigned char* known = (unsigned char*) calloc(q->nlabels + 1, 1);
+  int label;
+
+  q->known[slot + 1] = known;
+  if( slot >= 0 )
+    q->found++;
+  if( taboo > 0 )
+    known[taboo] = 2;
+  for(label = q->nlabels; label >= 1; label--) {
+    if( !known[label] ) {
+      known[label] = 1;
+      push_task(q,slot,label,0);
+    }
+  }
+}
+
+/*
+  The path from task->slot with task->label ends in slot (-1 for the artificial equilibrium). A new
+  equilibrium never walks back the path it was found by, as in all_lemke_gen; for a known one, the
+  path leading back is known only if the path had no ties in the ratio tests.
+*/
+static void record(shard_queue* q, shard_task* task, int slot, int degenerate) {
+  q->known[task->slot + 1][task->label] = 2;
+  if( !q->known[slot + 1] )
+    expand(q,slot,task->label);
+  else if( !degenerate )
+    q->known[slot + 1][task->label] = 2;
+}
+
+static eqlist* collect(shard_shared* sh) {
+  eqlist* list = 0;
+  equilibrium* eq;
+  shard_slot* slot;
+  long s;
+  int k, found;
+
+  for(s = 0; s < sh->nslots; s++) {
+    slot = get_slot(sh,s);
+    if( atomic_load(&slot->state) != SLOT_FULL )
+      continue;
+    eq = 0;
+    for(k = 0; k < slot->size; k++)
+      eq = add_strategy(eq,slot_labels(sh,slot)[k],slot_probs(sh,slot)[k]);
+    find_add_equilibrium(&list,eq,&found);
+    if( found )
+      free_equilibrium(eq);
+  }
+  return list;
+}
+
+static shard_shared* map_shared(double** bimatrix, int dim1, int dim2, long nslots) {
+  long page = sysconf(_SC_PAGESIZE);
+  int nlabels = dim1 + dim2, words = (nlabels + 63) / 64, fd, i;
+  long slot_bytes = sizeof(shard_slot) + words * sizeof(uint64_t) + 2L * nlabels * sizeof(int) + nlabels * sizeof(double);
+  long payoffs = page;
+  long table = payoffs + ((2L * dim1 * dim2 * sizeof(double) + page - 1) / page) * page;
+  long total = table + nslots * slot_bytes;
+  char name[64];
+  shard_shared* sh;
+
+  snprintf(name, sizeof(name), "/lemkehowson-%d", (int) getpid());
+  fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if( fd < 0 )
+    return 0;
+  shm_unlink(name);
+  if( ftruncate(fd, total) < 0 ) {
+    close(fd);
+    return 0;
+  }
+  sh = (shard_shared*) mmap(0, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if( sh == MAP_FAILED )
+    return 0;
+
+  sh->dim1 = dim1;
+  sh->dim2 = dim2;
+  sh->nlabels = nlabels;
+  sh->words = words;
+  sh->nslots = nslots;
+  sh->slot_bytes = slot_bytes;
+  sh->payoffs = payoffs;
+  sh->table = table;
+  for(i = 0; i < 2 * dim1; i++)
+    memcpy((char*) sh + payoffs + (long) i * dim2 * sizeof(double), bimatrix[i], dim2 * sizeof(double));
+  return sh;
+}
+
+static long shared_size(shard_shared* sh) {
+  return sh->table + sh->nslots * sh->slot_bytes;
+}
+
+/*
+  Moves the equilibria to a table twice as large, with the paths known and the tasks in the queue, whose
+  slots change. The workers must be stopped: they map the old table. Returns NULL, leaving the old table
+  as it is, if the new one cannot be mapped.
+*/
+static shard_shared* grow_table(shard_shared* sh, double** bimatrix, shard_queue* q) {
+  shard_shared* big = map_shared(bimatrix,sh->dim1,sh->dim2,2 * sh->nslots);
+  unsigned char** known;
+  shard_slot* slot;
+  long* moved;
+  long s, t, k;
+
+  if( !big )
+    return 0;
+
+  moved = (long*) malloc(sh->nslots * sizeof(long));
+  known = (unsigned char**) calloc(big->nslots + 1, sizeof(unsigned char*));
+  known[0] = q->known[0];
+  for(s = 0; s < sh->nslots; s++) {
+    moved[s] = -1;
+    slot = get_slot(sh,s);
+    //A slot left half written by a dead worker is dropped: its task was sent again
+    if( atomic_load(&slot->state) != SLOT_FULL ) {
+      free(q->known[s + 1]);
+      continue;
+    }
+    for(t = slot->hash & (big->nslots - 1); atomic_load(&get_slot(big,t)->state) != SLOT_EMPTY; t = (t + 1) & (big->nslots - 1));
+    memcpy(get_slot(big,t), slot, sh->slot_bytes);
+    moved[s] = t;
+    known[t + 1] = q->known[s + 1];
+  }
+  for(k = 0; k < q->count; k++) {
+    if( q->tasks[k].slot >= 0 )
+      q->tasks[k].slot = (int) moved[q->tasks[k].slot];
+  }
+
+  free(q->known);
+  q->known = known;
+  free(moved);
+  munmap(sh, shared_size(sh));
+  return big;
+}
+
+eqlist* all_lemke_sharded(double** bimatrix, int dim1, int dim2, int nworkers, int* steps, int debug, shard_stats* stats) {
+  shard_shared* sh = map_shared(bimatrix,dim1,dim2,SHARD_TABLE_SLOTS);
+  shard_shared* big;
+  shard_worker* workers = (shard_worker*) calloc(nworkers, sizeof(shard_worker));
+  struct pollfd* pfd = (struct pollfd*) malloc(nworkers * sizeof(struct pollfd));
+  int* polled = (int*) malloc(nworkers * sizeof(int));
+  void (*oldpipe)(int);
+  shard_queue q;
+  shard_result res;
+  shard_task task;
+  const char* error = 0;
+  eqlist* list = 0;
+  int w, n, busy = 0, threads = get_pivot_threads();
+  double start = now();
+
+  memset(stats, 0, sizeof(shard_stats));
+  stats->workers = nworkers;
+  if( !sh ) {
+    fprintf(stderr,"Cannot map the shared memory of the workers\n");
+    free(workers); free(pfd); free(polled);
+    stats->incomplete = 1;
+    return 0;
+  }
+
+  memset(&q, 0, sizeof(q));
+  q.nlabels = dim1 + dim2;
+  q.known = (unsigned char**) calloc(sh->nslots + 1, sizeof(unsigned char*));
+  expand(&q,-1,0);
+
+  //The threads of the pivoting pool would not exist in the workers: they pivot serially
+  set_pivot_threads(1);
+  oldpipe = signal(SIGPIPE, SIG_IGN);
+  for(w = 0; w < nworkers; w++)
+    workers[w].fd = -1;
+  for(w = 0; w < nworkers && !error; w++) {
+    if( start_worker(sh,workers,nworkers,w,debug) < 0 )
+      error = "Cannot start the workers";
+  }
+
+  while( !error && (q.count > 0 || busy > 0) ) {
+    //Once the table is half full no task is sent: when the workers are done, the table doubles
+    if( 2 * q.found >= sh->nslots && busy == 0 ) {
+      for(w = 0; w < nworkers; w++)
+	stop_worker(&workers[w]);
+      big = grow_table(sh,bimatrix,&q);
+      if( !big ) {
+	error = "Cannot grow the table of the equilibria";
+	break;
+      }
+      sh = big;
+      for(w = 0; w < nworkers && !error; w++) {
+	if( start_worker(sh,workers,nworkers,w,debug) < 0 )
+	  error = "Cannot start the workers";
+      }
+      continue;
+    }
+
+    //Sends a task to each idle worker, skipping the paths walked from their other end meanwhile
+    for(w = 0; w < nworkers && q.count > 0 && 2 * q.found < sh->nslots; w++) {
+      if( workers[w].busy )
+	continue;
+      prefer(&q,workers[w].at);
+      task = q.tasks[--q.count];
+      if( q.known[task.slot + 1][task.label] == 2 ) {
+	stats->skipped++;
+	w--;
+	continue;
+      }
+      workers[w].task = task;
+      workers[w].busy = 1;
+      busy++;
+      //A worker that died idle fails here, and its task goes back to the queue below
+      write_full(workers[w].fd, &task, sizeof(task));
+    }
+    if( busy == 0 )
+      continue;
+
+    for(w = 0, n = 0; w < nworkers; w++) {
+      if( workers[w].busy ) {
+	pfd[n].fd = workers[w].fd;
+	pfd[n].events = POLLIN;
+	polled[n++] = w;
+      }
+    }
+    if( poll(pfd, n, -1) < 0 ) {
+      if( errno != EINTR )
+	error = "Cannot wait for the workers";
+      continue;
+    }
+
+    for(n--; n >= 0; n--) {
+      w = polled[n];
+      if( !pfd[n].revents )
+	continue;
+      workers[w].busy = 0;
+      busy--;
+
+      if( read_full(workers[w].fd, &res, sizeof(res)) < 0 ) {
+	//The worker died: its task is sent again, to a new worker
+	stop_worker(&workers[w]);
+	if( ++workers[w].task.retries >= SHARD_MAX_RETRIES ) {
+	  error = "A task keeps killing its workers";
+	  break;
+	}
+	push_task(&q,workers[w].task.slot,workers[w].task.label,workers[w].task.retries);
+	stats->restarts++;
+	if( start_worker(sh,workers,nworkers,w,debug) < 0 )
+	  error = "Cannot start the workers";
+	continue;
+      }
+      if( res.slot == -2 ) {
+	error = "The table of the equilibria is full";
+	break;
+      }
+
+      workers[w].at = res.degenerate ? -2 : res.slot;
+      stats->tasks++;
+      stats->rebuild += res.rebuild;
+      *steps += res.steps;
+      record(&q,&workers[w].task,res.slot,res.degenerate);
+    }
+  }
+
+  for(w = 0; w < nworkers; w++) {
+    if( workers[w].fd >= 0 )
+      stop_worker(&workers[w]);
+  }
+  signal(SIGPIPE, oldpipe);
+  set_pivot_threads(threads);
+
+  if( error ) {
+    fprintf(stderr,"%s: the enumeration stopped, and only the equilibria found until then are listed\n",error);
+    stats->incomplete = 1;
+  }
+  list = collect(sh);
+  stats->slots = sh->nslots;
+
+  for(w = 0; w <= sh->nslots; w++)
+    free(q.known[w]);
+  free(q.known);
+  free(q.tasks);
+  free(workers);
+  free(pfd);
+  free(polled);
+  munmap(sh, shared_size(sh));
+  stats->elapsed = now() - start;
+  return list;
+}
+
+void shard_print_stats(shard_stats* stats, FILE* f) {
+  fprintf(f,"%d workers: %ld paths walked, %ld skipped as walked from their other end, %ld pivots to rebuild the bases, %d workers restarted, %ld slots in the table, %.3lf seconds\n",
+	  stats->workers,stats->tasks,stats->skipped,stats->rebuild,stats->restarts,stats->slots,stats->elapsed);
+}
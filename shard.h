@@ -0,0 +1,76 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include "algorithm.h"
+
+/*
+  Enumeration of all equilibria by several processes. The coordinator copies the positivized bimatrix
+  in POSIX shared memory, with a hash table of the equilibria found, and forks the workers, which map
+  the payoffs read-only. A task is a Lemke-Howson path to walk: an equilibrium of the table (or the
+  artificial one) and a label. The coordinator sends the tasks to the workers on Unix sockets, one at a
+  time per worker; the worker builds the tableaus at the basis of the equilibrium, walks the path, adds
+  the equilibrium at its end to the table, and answers with its slot and the number of pivots.
+
+  The table is shared by all the workers without locks: a slot is claimed by a compare-and-swap of its
+  state from empty to the pid of the worker, and published by setting it to full once the equilibrium
+  is written. As in find_add_equilibrium, two equilibria are the same if they have the same support.
+
+  The equilibria live in shared memory, so a worker that dies loses nothing but the task it was doing:
+  the coordinator forks another worker and sends the task again. A slot left half written by a dead
+  worker is taken over by the next worker that reaches it.
+
+  The coordinator knows the two ends of every path walked, so, as the memoization of all_lemke_gen,
+  it never sends a path whose other end was already walked, in particular the one leading back to the
+  equilibrium a new one was found from, unless a ratio test of the path had a tie.
+
+  On nondegenerate games the equilibria are those of all_lemke_gen. On degenerate games, where the
+  ratio tests have ties, the equilibria reached depend on the order in which the paths are walked, and
+  on whether the tableaus were reached by pivoting or built from the basis: the list can differ. A path
+  that lemke_howson_gen abandons, or that leaves a basis too singular to build, is taken as ending in the
+  artificial equilibrium.
+*/
+
+#define SHARD_MAX_WORKERS 256
+
+/*
+  Slots of the table of equilibria at the start (a power of 2). When half of them are taken, the coordinator
+  lets the workers finish their paths, moves the equilibria to a table twice as large, and starts the workers
+  again on it. Half a table is always more than the paths in flight, so the table never fills.
+*/
+#define SHARD_TABLE_SLOTS (1 << 10)
+
+/*
+  A worker keeps its tableaus at the end of the last path it walked, and the coordinator sends it, when
+  it can, a path leaving from there: it looks for one among this number of tasks on top of the queue.
+  The other tasks need the tableaus built again at the basis of the equilibrium they leave.
+*/
+#define SHARD_AFFINITY 64
+
+//A task that made its worker die this number of times stops the enumeration
+#define SHARD_MAX_RETRIES 3
+
+//Spins on a slot being written before checking whether its writer is still alive
+#define SHARD_SPIN_CHECK 4096
+
+typedef struct shard_stats_ {
+  int workers;
+  long tasks;         //Paths walked by the workers
+  long skipped;       //Paths not sent because their other end was walked
+  long rebuild;       //Pivots to build the tableaus at the basis of the equilibria the paths leave
+  int restarts;       //Workers forked again after dying
+  long slots;         //Slots of the table of equilibria at the end
+  int incomplete;     //The enumeration stopped on an error: the list holds the equilibria found until then
+  double elapsed;
+} shard_stats;
+
+/*
+  Same as all_lemke_gen from the artificial equilibrium, with the given number of worker processes.
+  The pivots along the paths are added to *steps. If the enumeration cannot go on (the shared memory
+  cannot be mapped or grown, or a task keeps killing its workers) it prints why, sets stats->incomplete,
+  and returns the equilibria found until then.
+*/
+eqlist* all_lemke_sharded(double** bimatrix, int dim1, int dim2, int workers, int* steps, int debug, shard_stats* stats);
+
+void shard_print_stats(shard_stats* stats, FILE* f);
+
+#endif
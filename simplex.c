@@ -0,0 +1,158 @@
+/*
+  Simplex library.
+
+  When A + B is constant, the game is strategically equivalent to the zero-sum game (A, -A), and its equilibria are
+  the pairs of optimal strategies of a linear program and of its dual. With positive payoffs the LP of the second player is
+      max sum_j w_j   subject to   A w <= 1,  w >= 0
+  and its constraints are exactly the first tableau built by create_systems (r = 1 - A w). We add the objective row
+      z = sum_j w_j
+  as an additional row of that tableau, and solve with the usual simplex method, reusing the pivoting kernels of the
+  Lemke-Howson algorithm: the objective row is updated by the elimination, but excluded from the ratio test.
+
+  At the optimum z* = 1/v, where v is the value of the positivized game. The strategy of the second player is w/z*, and
+  the strategy of the first player comes from the dual: u_i is minus the coefficient of the slack variable r_i in the
+  objective row.
+*/
+
+#include "simplex.h"
+
+//Tolerance of the simplex method on reduced costs and values: eps is far too small for an optimality test
+#define lp_eps 1e-12
+
+/*
+  The game is constant-sum if A[i][j] + B[i][j] is the same for all i, j, up to a tolerance relative to the payoffs.
+*/
+
+int is_constant_sum_bimatrix(double** bimatrix, int dim1, int dim2) {
+  int i, j;
+  double c = bimatrix[0][0] + bimatrix[dim1][0];
+  double maxabs = 0.0;
+
+  for(i = 0; i < (2 * dim1); i++)
+    for(j = 0; j < dim2; j++)
+      maxabs = fabs(bimatrix[i][j]) > maxabs ? fabs(bimatrix[i][j]) : maxabs;
+
+  for(i = 0; i < dim1; i++) {
+    for(j = 0; j < dim2; j++) {
+      if( fabs(bimatrix[i][j] + bimatrix[dim1 + i][j] - c) > CONSTSUM_TOL * (maxabs + 1.0) )
+	return 0;
+    }
+  }
+
+  return 1;
+}
+
+double** create_lp_system(double** bimatrix, int dim1, int dim2) {
+  int i, j;
+  int width = 2 + dim1 + dim2;
+
+  double** tableau = (double**) malloc( (dim1 + 1) * sizeof(double*) );
+  for(i = 0; i <= dim1; i++)
+    tableau[i] = (double*) calloc( width, sizeof(double) );
+
+  for(i = 0; i < dim1; i++) {
+    tableau[i][0] = - i - 1.0;
+    tableau[i][1] = 1.0;
+    for(j = (2 + dim1); j < width; j++)
+      tableau[i][j] = - bimatrix[i][j - 2 - dim1];
+  }
+
+  //The objective row
+  for(j = (2 + dim1); j < width; j++)
+    tableau[dim1][j] = 1.0;
+
+  return tableau;
+}
+
+//Labels of the variables, following the same convention of get_column for the first tableau
+
+static int column_label(int dim1, int column) {
+  return column <= dim1 + 1 ? -(column - 1) : column - 1;
+}
+
+equilibrium* constant_sum_simplex(double** tableau, int dim1, int dim2, int* steps, int* unique, int debug) {
+  int i, j, column, index, leaving, width = 2 + dim1 + dim2;
+  double best, z;
+  double* obj = tableau[dim1];
+  equilibrium* eq = 0;
+
+  *steps = 0;
+
+  for(;;) {
+    /*
+      Dantzig's rule: the entering variable is the one with the largest coefficient in the objective row. When there
+      is no positive coefficient, we are at the optimum.
+    */
+    column = -1;
+    best = lp_eps;
+    for(j = 2; j < width; j++) {
+      if( obj[j] > best ) {
+	best = obj[j];
+	column = j;
+      }
+    }
+    if( column < 0 )
+      break;
+
+    (*steps)++;
+
+    //The LP is bounded (A > 0), so the ratio test always finds a row
+    index = min_ratio_row(tableau,dim1,column,debug);
+    assert(index >= 0);
+
+    leaving = (int) tableau[index][0];
+
+    if( debug & 0x01 )
+      fprintf(stdout,"Simplex step %d. Label in basis: %d. \t Label out of basis: %d.\t Index of row: %d\n",*steps,column_label(dim1,column),leaving,index);
+
+    pivot_tableau(tableau,dim1+1,width,index,column,get_column(dim1,dim2,leaving),column_label(dim1,column));
+  }
+
+  if( debug & 0x02 ) {
+    fprintf(stdout,"Tableau after the simplex execution:\n");
+    view_tableau_gen(tableau,dim1,dim2,stdout);
+  }
+
+  /*
+    The equilibrium is unique if the optimal solutions of both the LP and its dual are unique: no variable in basis has
+    value zero (primal degeneracy) and no variable out of basis has zero reduced cost (dual degeneracy).
+  */
+  *unique = 1;
+  for(i = 0; i < dim1; i++) {
+    if( tableau[i][1] < lp_eps )
+      *unique = 0;
+  }
+  for(j = 2; j < width; j++) {
+    if( obj[j] > -lp_eps ) {
+      //The columns of the variables in basis are zero, and they don't count
+      int inbasis = 0;
+      for(i = 0; i < dim1; i++)
+	if( (int) tableau[i][0] == column_label(dim1,j) )
+	  inbasis = 1;
+      if( !inbasis )
+	*unique = 0;
+    }
+  }
+
+  z = obj[1];
+
+  for(i = 1; i <= dim1; i++) {
+    double u = - obj[get_column(dim1,dim2,-i)];
+    if( u > lp_eps )
+      eq = add_strategy(eq,i,u/z);
+  }
+  for(i = 0; i < dim1; i++) {
+    if( tableau[i][0] > 0 && tableau[i][1] > lp_eps )
+      eq = add_strategy(eq,(int) tableau[i][0],tableau[i][1]/z);
+  }
+
+  return eq;
+}
+
+void free_lp_system(double** tableau, int dim1) {
+  int i;
+
+  for(i = 0; i <= dim1; i++)
+    free(tableau[i]);
+  free(tableau);
+}
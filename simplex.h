@@ -0,0 +1,23 @@
+#ifndef SIMPLEX_H
+#define SIMPLEX_H
+
+#include "algorithm.h"
+
+//Tolerance (relative to the largest payoff) used to decide if a game is constant-sum
+#define CONSTSUM_TOL 1e-9
+
+//Tells if A + B is constant
+int is_constant_sum_bimatrix(double** bimatrix, int dim1, int dim2);
+
+//Creates the tableau for the LP of a constant-sum game: the first tableau of create_systems, plus the objective row
+double** create_lp_system(double** bimatrix, int dim1, int dim2);
+
+/*
+  Solves a constant-sum game with the simplex method. unique is set to 1 if the equilibrium found is the only one,
+  0 if the (convex) set of equilibria may contain other points.
+*/
+equilibrium* constant_sum_simplex(double** tableau, int dim1, int dim2, int* steps, int* unique, int debug);
+
+void free_lp_system(double** tableau, int dim1);
+
+#endif
@@ -0,0 +1,356 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "tune.h"
+#include "batch.h"
+
+/*
+  The pivots are timed on the first steps of a Lemke-Howson path of a random square game, so that the
+  tableaus have the fill of real ones (whole paths can be too long to walk in a calibration), and the ratio tests on a tableau of three columns with random coefficients.
+  A variant wins at a size if it takes less time per operation than the serial one by TUNE_MARGIN; the
+  crossover is the first measured size from which it wins at every larger size, so that a size where
+  the two are within the noise does not turn the threads on and off.
+*/
+
+static double seconds(struct timeval* start) {
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return (now.tv_sec - start->tv_sec) + (now.tv_usec - start->tv_usec) / 1e6;
+}
+
+//Walks at most TUNE_PATH_PIVOTS steps of the Lemke-Howson path from pivot 1, as lemke_howson_gen does, and returns the steps
+static int walk_path(double*** tableaus, int dim) {
+  int pivot = get_pivot_gen(tableaus,dim,dim,1);
+  int ntab, column, index, leaving, steps = 0;
+
+  do {
+    ntab = get_tableau(dim,dim,pivot);
+    column = get_column(dim,dim,pivot);
+    index = min_ratio_row(tableaus[ntab],dim,column,0);
+    leaving = (int) tableaus[ntab][index][0];
+    pivot_tableau(tableaus[ntab],dim,2 * dim + 2,index,column,get_column(dim,dim,leaving),pivot);
+    pivot = -leaving;
+    steps++;
+  } while( leaving != 1 && leaving != -1 && steps < TUNE_PATH_PIVOTS );
+
+  return steps;
+}
+
+//Seconds per pivot on the path from pivot 1 of the game (positivized)
+static double time_pivots(double** bimatrix, int dim) {
+  struct timeval start;
+  double*** tableaus;
+  double elapsed = 0.0;
+  long pivots = 0;
+
+  do {
+    tableaus = create_systems(bimatrix,dim,dim);
+    gettimeofday(&start, NULL);
+    pivots += walk_path(tableaus,dim);
+    elapsed += seconds(&start);
+    free_tableaus(tableaus,dim,dim);
+  } while( elapsed < TUNE_MIN_TIME );
+
+  return elapsed / pivots;
+}
+
+//Seconds per ratio test on the column 2 of the tableau
+static double time_ratio(double** tableau, int nlines) {
+  struct timeval start;
+  volatile int sink = 0;
+  double elapsed;
+  long tests = 0;
+
+  gettimeofday(&start, NULL);
+  do {
+    sink += min_ratio_row(tableau,nlines,2,0);
+    tests++;
+  } while( (elapsed = seconds(&start)) < TUNE_MIN_TIME );
+
+  (void) sink;
+  return elapsed / tests;
+}
+
+static double** tune_next_game(void* ctx, int k, double* min) {
+  int dim = *(int*) ctx;
+  return get_random_bimatrix_seeded(dim,dim,TUNE_SEED,k,1,min);
+}
+
+//Seconds per game solved from pivot 1, with the batch lanes or one at a time as in batch mode
+static double time_games(int dim, int lanes) {
+  equilibrium** results = (equilibrium**) malloc(TUNE_BATCH_GAMES * sizeof(equilibrium*));
+  int* steps = (int*) malloc(TUNE_BATCH_GAMES * sizeof(int));
+  struct timeval start;
+  double** bimatrix;
+  double*** tableaus;
+  double min;
+  long games = 0;
+  double elapsed;
+  int k;
+
+  gettimeofday(&start, NULL);
+  do {
+    if( lanes )
+      batch_lemke_howson(tune_next_game,&dim,TUNE_BATCH_GAMES,dim,dim,1,results,steps);
+    else {
+      for(k = 0; k < TUNE_BATCH_GAMES; k++) {
+	bimatrix = tune_next_game(&dim,k,&min);
+	positivize_bimatrix(bimatrix,dim,dim,min);
+	tableaus = create_systems(bimatrix,dim,dim);
+	results[k] = lemke_howson_gen(tableaus,bimatrix,dim,dim,1,&steps[k],0,0);
+	free_tableaus(tableaus,dim,dim);
+	free_bimatrix(bimatrix,dim,dim);
+      }
+    }
+    for(k = 0; k < TUNE_BATCH_GAMES; k++)
+      free_equilibrium(results[k]);
+    games += TUNE_BATCH_GAMES;
+  } while( (elapsed = seconds(&start)) < TUNE_MIN_TIME );
+
+  free(results);
+  free(steps);
+  return elapsed / games;
+}
+
+static long crossover(tune_point* points, int n) {
+  long size = -1;
+  int i;
+
+  for(i = n - 1; i >= 0 && points[i].variant * TUNE_MARGIN < points[i].base; i--)
+    size = points[i].size;
+  return size;
+}
+
+static void calibrate_pivots(tune_profile* tp, FILE* log) {
+  int dims[] = TUNE_PIVOT_DIMS;
+  double** bimatrix;
+  tune_point* p;
+  double min;
+  int i;
+
+  tp->npivot = 0;
+  for(i = 0; i < (int) (sizeof(dims) / sizeof(dims[0])); i++) {
+    bimatrix = get_random_bimatrix_seeded(dims[i],dims[i],TUNE_SEED,0,1,&min);
+    positivize_bimatrix(bimatrix,dims[i],dims[i],min);
+    p = &tp->pivot[tp->npivot++];
+    p->size = (long) dims[i] * (2 + 2 * dims[i]);
+
+    set_pivot_threads(1);
+    p->base = time_pivots(bimatrix,dims[i]);
+    set_pivot_threads(tp->threads);
+    set_parallel_thresholds(0,-1);
+    p->variant = time_pivots(bimatrix,dims[i]);
+    set_parallel_thresholds(PIVOT_PARALLEL_MIN,RATIO_PARALLEL_MIN);
+    set_pivot_threads(1);
+
+    fprintf(log,"Pivots, %dx%d game (%ld coefficients): %.2lf us serial, %.2lf us with %d threads\n",
+	    dims[i],dims[i],p->size,p->base * 1e6,p->variant * 1e6,tp->threads);
+    free_bimatrix(bimatrix,dims[i],dims[i]);
+  }
+  tp->pivot_parallel_min = crossover(tp->pivot,tp->npivot);
+}
+
+static void calibrate_ratio(tune_profile* tp, FILE* log) {
+  int rows[] = TUNE_RATIO_ROWS;
+  int n = rows[sizeof(rows) / sizeof(rows[0]) - 1];
+  double* arena = (double*) malloc((long) n * 3 * sizeof(double));
+  double** tableau = (double**) malloc(n * sizeof(double*));
+  tune_point* p;
+  int i;
+
+  srand(TUNE_SEED);
+  for(i = 0; i < n; i++) {
+    tableau[i] = arena + 3L * i;
+    tableau[i][0] = i;
+    tableau[i][1] = 1.0 + rand() / (double) RAND_MAX;
+    tableau[i][2] = 2.0 * rand() / (double) RAND_MAX - 1.0;
+  }
+
+  tp->nratio = 0;
+  for(i = 0; i < (int) (sizeof(rows) / sizeof(rows[0])); i++) {
+    p = &tp->ratio[tp->nratio++];
+    p->size = rows[i];
+
+    set_pivot_threads(1);
+    p->base = time_ratio(tableau,rows[i]);
+    set_pivot_threads(tp->threads);
+    set_parallel_thresholds(-1,0);
+    p->variant = time_ratio(tableau,rows[i]);
+    set_parallel_thresholds(PIVOT_PARALLEL_MIN,RATIO_PARALLEL_MIN);
+    set_pivot_threads(1);
+
+    fprintf(log,"Ratio tests, %d rows: %.2lf us serial, %.2lf us with %d threads\n",rows[i],p->base * 1e6,p->variant * 1e6,tp->threads);
+  }
+  tp->ratio_parallel_min = crossover(tp->ratio,tp->nratio);
+
+  free(tableau);
+  free(arena);
+}
+
+static void calibrate_batch(tune_profile* tp, FILE* log) {
+  int dims[] = TUNE_BATCH_DIMS;
+  tune_point* p;
+  int i;
+
+  tp->nbatch = 0;
+  for(i = 0; i < (int) (sizeof(dims) / sizeof(dims[0])); i++) {
+    p = &tp->batch[tp->nbatch++];
+    p->size = dims[i];
+    p->base = time_games(dims[i],0);
+    p->variant = time_games(dims[i],1);
+    fprintf(log,"Games %dx%d: %.0lf games/sec one at a time, %.0lf games/sec batched\n",dims[i],dims[i],1.0 / p->base,1.0 / p->variant);
+  }
+  tp->batch_min_dim = (int) crossover(tp->batch,tp->nbatch);
+}
+
+void tune_calibrate(tune_profile* tp, int threads, FILE* log) {
+  memset(tp, 0, sizeof(tune_profile));
+  gethostname(tp->host,sizeof(tp->host) - 1);
+  tp->processors = (int) sysconf(_SC_NPROCESSORS_ONLN);
+  tp->threads = threads > 0 ? threads : tp->processors;
+
+  calibrate_batch(tp,log);
+  //A single thread has nothing to split: the serial kernels are the only ones
+  if( tp->threads > 1 ) {
+    calibrate_pivots(tp,log);
+    calibrate_ratio(tp,log);
+  }
+  else {
+    tp->pivot_parallel_min = -1;
+    tp->ratio_parallel_min = -1;
+  }
+}
+
+static void save_points(const char* key, tune_point* points, int n, FILE* f) {
+  int i;
+
+  for(i = 0; i < n; i++)
+    fprintf(f,"%s %ld %.9le %.9le\n",key,points[i].size,points[i].base,points[i].variant);
+}
+
+int tune_save(tune_profile* tp, const char* file) {
+  FILE* f = fopen(file, "w");
+
+  if( !f )
+    return -1;
+  fprintf(f,"%s\n",TUNE_HEADER);
+  fprintf(f,"host %s\n",tp->host);
+  fprintf(f,"processors %d\nthreads %d\n",tp->processors,tp->threads);
+  fprintf(f,"pivot_parallel_min %ld\nratio_parallel_min %ld\nbatch_min_dim %d\n",tp->pivot_parallel_min,tp->ratio_parallel_min,tp->batch_min_dim);
+  save_points("pivot",tp->pivot,tp->npivot,f);
+  save_points("ratio",tp->ratio,tp->nratio,f);
+  save_points("batch",tp->batch,tp->nbatch,f);
+  return fclose(f) == 0 ? 0 : -1;
+}
+
+static void load_point(tune_point* points, int* n, const char* values) {
+  if( *n < TUNE_MAX_POINTS && sscanf(values,"%ld %le %le",&points[*n].size,&points[*n].base,&points[*n].variant) == 3 )
+    (*n)++;
+}
+
+int tune_load(tune_profile* tp, const char* file) {
+  FILE* f = fopen(file, "r");
+  char line[256], key[32];
+  int skip;
+
+  if( !f )
+    return -1;
+  memset(tp, 0, sizeof(tune_profile));
+  if( !fgets(line,sizeof(line),f) || strncmp(line,TUNE_HEADER,strlen(TUNE_HEADER)) != 0 ) {
+    fclose(f);
+    return -1;
+  }
+
+  //Unknown keys are ignored, so that older solvers read the profiles of newer ones
+  while( fgets(line,sizeof(line),f) ) {
+    if( sscanf(line,"%31s %n",key,&skip) != 1 )
+      continue;
+    if( strcmp(key,"host") == 0 )
+      sscanf(line + skip,"%63s",tp->host);
+    else if( strcmp(key,"processors") == 0 )
+      sscanf(line + skip,"%d",&tp->processors);
+    else if( strcmp(key,"threads") == 0 )
+      sscanf(line + skip,"%d",&tp->threads);
+    else if( strcmp(key,"pivot_parallel_min") == 0 )
+      sscanf(line + skip,"%ld",&tp->pivot_parallel_min);
+    else if( strcmp(key,"ratio_parallel_min") == 0 )
+      sscanf(line + skip,"%ld",&tp->ratio_parallel_min);
+    else if( strcmp(key,"batch_min_dim") == 0 )
+      sscanf(line + skip,"%d",&tp->batch_min_dim);
+    else if( strcmp(key,"pivot") == 0 )
+      load_point(tp->pivot,&tp->npivot,line + skip);
+    else if( strcmp(key,"ratio") == 0 )
+      load_point(tp->ratio,&tp->nratio,line + skip);
+    else if( strcmp(key,"batch") == 0 )
+      load_point(tp->batch,&tp->nbatch,line + skip);
+  }
+  fclose(f);
+
+  tp->threads = tp->threads > 0 ? tp->threads : 1;
+  return 0;
+}
+
+void tune_apply(tune_profile* tp) {
+  set_parallel_thresholds(tp->pivot_parallel_min,tp->ratio_parallel_min);
+}
+
+int tune_pivot_threads(tune_profile* tp, int dim1, int dim2) {
+  long size = (long) (dim1 > dim2 ? dim1 : dim2) * (2 + dim1 + dim2);
+
+  if( tp->pivot_parallel_min < 0 || size < tp->pivot_parallel_min )
+    return 1;
+  return tp->threads;
+}
+
+int tune_batch_lanes(tune_profile* tp, int dim1, int dim2) {
+  int dim = dim1 > dim2 ? dim1 : dim2;
+
+  return tp->batch_min_dim >= 0 && tp->nbatch > 0 && dim >= tp->batch_min_dim && dim <= tp->batch[tp->nbatch - 1].size;
+}
+
+//last is the largest size measured, for a crossover that does not hold above it (-1 otherwise)
+static void report_crossover(const char* what, long size, long last, const char* unit, FILE* f) {
+  if( size < 0 )
+    fprintf(f,"%s: never\n",what);
+  else if( last >= 0 )
+    fprintf(f,"%s: from %ld to %ld %s (the largest size measured)\n",what,size,last,unit);
+  else
+    fprintf(f,"%s: from %ld %s\n",what,size,unit);
+}
+
+void tune_report(tune_profile* tp, int dim1, int dim2, FILE* f) {
+  char host[64] = "";
+  int i;
+
+  gethostname(host,sizeof(host) - 1);
+  fprintf(f,"Profile calibrated on %s (%d processors, threaded kernels measured with %d threads)\n",tp->host,tp->processors,tp->threads);
+  if( strcmp(host,tp->host) != 0 )
+    fprintf(f,"Warning: this host is %s, the crossovers may not hold here\n",host);
+
+  if( tp->npivot > 0 )
+    fprintf(f,"\nCoefficients\tSerial pivot (us)\tThreaded pivot (us)\tSpeedup\n");
+  for(i = 0; i < tp->npivot; i++)
+    fprintf(f,"%ld\t\t%.2lf\t\t\t%.2lf\t\t\t%.2lf\n",tp->pivot[i].size,tp->pivot[i].base * 1e6,tp->pivot[i].variant * 1e6,tp->pivot[i].base / tp->pivot[i].variant);
+  if( tp->nratio > 0 )
+    fprintf(f,"\nRows\t\tSerial ratio test (us)\tThreaded ratio test (us)\tSpeedup\n");
+  for(i = 0; i < tp->nratio; i++)
+    fprintf(f,"%ld\t\t%.2lf\t\t\t%.2lf\t\t\t\t%.2lf\n",tp->ratio[i].size,tp->ratio[i].base * 1e6,tp->ratio[i].variant * 1e6,tp->ratio[i].base / tp->ratio[i].variant);
+  if( tp->nbatch > 0 )
+    fprintf(f,"\nGame\t\tOne at a time (games/s)\tBatched (games/s)\tSpeedup\n");
+  for(i = 0; i < tp->nbatch; i++)
+    fprintf(f,"%ldx%ld\t\t%.0lf\t\t\t%.0lf\t\t\t%.2lf\n",tp->batch[i].size,tp->batch[i].size,1.0 / tp->batch[i].base,1.0 / tp->batch[i].variant,tp->batch[i].base / tp->batch[i].variant);
+
+  fprintf(f,"\n");
+  report_crossover("Threaded pivots",tp->pivot_parallel_min,-1,"coefficients",f);
+  report_crossover("Threaded ratio tests",tp->ratio_parallel_min,-1,"rows",f);
+  report_crossover("Batch lanes",tp->batch_min_dim,tp->nbatch > 0 ? tp->batch[tp->nbatch - 1].size : -1,"strategies",f);
+
+  fprintf(f,"\nDecisions for a %dx%d game (%ld coefficients in the larger tableau):\n",dim1,dim2,(long) (dim1 > dim2 ? dim1 : dim2) * (2 + dim1 + dim2));
+  fprintf(f,"Pivoting threads: %d\n",tune_pivot_threads(tp,dim1,dim2));
+  fprintf(f,"Ratio tests: %s\n",tp->ratio_parallel_min >= 0 && tune_pivot_threads(tp,dim1,dim2) > 1 && (dim1 > dim2 ? dim1 : dim2) >= tp->ratio_parallel_min ?
+	  "threaded" : "serial");
+  fprintf(f,"Batch mode (-n): %s\n",tune_batch_lanes(tp,dim1,dim2) ? "batched" : "one at a time");
+}
@@ -0,0 +1,78 @@
+#ifndef TUNE_H
+#define TUNE_H
+
+#include <stdio.h>
+
+/*
+  Tuning of the kernels to the host. Where the threaded kernels start to pay off, and whether the batch
+  lanes beat solving small games one at a time, depends on the processors, the caches and the memory of
+  the machine: the defaults (PIVOT_PARALLEL_MIN, RATIO_PARALLEL_MIN, and the batch lanes at every size)
+  are a guess. The calibration times the kernels on synthetic games and tableaus of growing size, and
+  keeps the smallest size from which the faster variant stays faster: that is the crossover, written in
+  a text profile with the measurements behind it. The solver reads the profile at startup and chooses
+  the variant of each kernel from the size of the game.
+*/
+
+#define TUNE_HEADER "lemkehowson tuning profile 1"
+
+//Each measurement is repeated until it takes at least this number of seconds
+#define TUNE_MIN_TIME 0.05
+
+//Sizes measured: square games for the pivots and the batch lanes, rows of a tableau for the ratio tests
+#define TUNE_PIVOT_DIMS { 16, 32, 64, 128, 256, 512 }
+#define TUNE_RATIO_ROWS { 256, 1024, 4096, 16384, 65536, 262144 }
+#define TUNE_BATCH_DIMS { 2, 3, 4, 5, 6, 8, 10, 12 }
+
+//Pivots timed on each walk of a path: the tableaus are built again for the next walk
+#define TUNE_PATH_PIVOTS 64
+
+//Games solved at each measurement of the batch lanes (enough for the lanes left empty at the end not to count), and seed of all the synthetic games
+#define TUNE_BATCH_GAMES 4096
+#define TUNE_SEED 1
+
+#define TUNE_MAX_POINTS 16
+
+//A variant wins at a size only if it is faster than the serial one by at least this factor, above the noise of the measurements
+#define TUNE_MARGIN 1.1
+
+typedef struct tune_point_ {
+  long size;       //Coefficients of the tableau, rows of the tableau, or dimension of the game
+  double base;     //Seconds per operation of the serial variant (pivot, ratio test, game)
+  double variant;  //Seconds per operation of the threaded kernel, or of the batch lanes
+} tune_point;
+
+typedef struct tune_profile_ {
+  char host[64];
+  int processors;           //Online processors of the host
+  int threads;              //Threads of the threaded kernels, when they are used
+  long pivot_parallel_min;  //Crossover of the pivots, in coefficients (-1 if the threaded kernel never wins)
+  long ratio_parallel_min;  //Crossover of the ratio tests, in rows (-1 if never)
+  int batch_min_dim;        //Crossover of the batch lanes, in strategies of the larger player (-1 if never), up to the largest size measured
+  int npivot, nratio, nbatch;
+  tune_point pivot[TUNE_MAX_POINTS];
+  tune_point ratio[TUNE_MAX_POINTS];
+  tune_point batch[TUNE_MAX_POINTS];
+} tune_profile;
+
+//Measures the kernels with the given number of threads (0 for one per processor), printing the progress on log
+void tune_calibrate(tune_profile* tp, int threads, FILE* log);
+
+//Return 0 on success, and -1 if the file cannot be opened or is not a profile
+int tune_save(tune_profile* tp, const char* file);
+int tune_load(tune_profile* tp, const char* file);
+
+//Sets the thresholds of the kernels to the crossovers of the profile
+void tune_apply(tune_profile* tp);
+
+/*
+  Decisions for a game of size dim1 x dim2: threads of the pivots (1 for serial), and whether to use the batch
+  lanes. The gain of the threads grows with the size, so above the largest size measured they keep the decision
+  taken there; the gain of the lanes shrinks, and above the largest size measured the games are solved one at a time.
+*/
+int tune_pivot_threads(tune_profile* tp, int dim1, int dim2);
+int tune_batch_lanes(tune_profile* tp, int dim1, int dim2);
+
+//Prints the measurements, the crossovers, and the decisions for a game of size dim1 x dim2
+void tune_report(tune_profile* tp, int dim1, int dim2, FILE* f);
+
+#endif
@@ -0,0 +1,245 @@
+/*
+  Verification and refinement of the equilibria.
+
+  The check costs two matrix-vector products on the bimatrix, that is about as much as a couple of
+  pivoting steps, so it can be done on every result. The refinement solves the indifference
+  conditions on the support: in a nondegenerate game the supports of the two players have the same
+  size k, and the probabilities of each player are the solution of a (k+1)x(k+1) linear system,
+  which we solve with Gaussian elimination in long double.
+*/
+
+#include "verify.h"
+
+/*
+  Expands the equilibrium to the two dense strategy vectors. Labels up to dim1 belong to the
+  first player, the others to the second one.
+*/
+
+static void dense_strategies(equilibrium* eq, int dim1, double* x, double* y) {
+  for( ; eq != 0; eq = eq->next ) {
+    if( eq->label <= dim1 )
+      x[eq->label - 1] = eq->prob;
+    else
+      y[eq->label - dim1 - 1] = eq->prob;
+  }
+}
+
+/*
+  Payoffs of the pure strategies of the first player against y: the rows are processed in blocks,
+  so that each element of y is loaded once for VERIFY_BLOCK rows.
+*/
+
+static void rows_times_vector(double** m, int nrows, int ncols, double* v, double* out) {
+  int i, j, b;
+  double s[VERIFY_BLOCK];
+
+  for(i = 0; i + VERIFY_BLOCK <= nrows; i += VERIFY_BLOCK) {
+    for(b = 0; b < VERIFY_BLOCK; b++)
+      s[b] = 0.0;
+    for(j = 0; j < ncols; j++)
+      for(b = 0; b < VERIFY_BLOCK; b++)
+	s[b] += m[i + b][j] * v[j];
+    for(b = 0; b < VERIFY_BLOCK; b++)
+      out[i + b] = s[b];
+  }
+
+  for( ; i < nrows; i++) {
+    s[0] = 0.0;
+    for(j = 0; j < ncols; j++)
+      s[0] += m[i][j] * v[j];
+    out[i] = s[0];
+  }
+}
+
+/*
+  Payoffs of the pure strategies of the second player against x: we accumulate the rows of B
+  weighted by x, skipping the strategies out of the support, so the access is contiguous.
+*/
+
+static void vector_times_rows(double** m, int nrows, int ncols, double* v, double* out) {
+  int i, j;
+
+  for(j = 0; j < ncols; j++)
+    out[j] = 0.0;
+
+  for(i = 0; i < nrows; i++) {
+    if( v[i] == 0.0 )
+      continue;
+    for(j = 0; j < ncols; j++)
+      out[j] += v[i] * m[i][j];
+  }
+}
+
+int check_equilibrium(double** bimatrix, int dim1, int dim2, equilibrium* eq, eq_check* check) {
+  double* x = (double*) calloc(dim1, sizeof(double));
+  double* y = (double*) calloc(dim2, sizeof(double));
+  double* ay = (double*) malloc(dim1 * sizeof(double));
+  double* xb = (double*) malloc(dim2 * sizeof(double));
+  double u1 = 0.0, u2 = 0.0, best1 = -HUGE_VAL, best2 = -HUGE_VAL, sum1 = 0.0, sum2 = 0.0, neg = 0.0;
+  double max = bimatrix[0][0], min = bimatrix[0][0];
+  int i, j;
+
+  dense_strategies(eq,dim1,x,y);
+
+  rows_times_vector(bimatrix,dim1,dim2,y,ay);
+  vector_times_rows(bimatrix + dim1,dim1,dim2,x,xb);
+
+  for(i = 0; i < dim1; i++) {
+    u1 += x[i] * ay[i];
+    sum1 += x[i];
+    neg = x[i] < neg ? x[i] : neg;
+    best1 = ay[i] > best1 ? ay[i] : best1;
+  }
+  for(j = 0; j < dim2; j++) {
+    u2 += y[j] * xb[j];
+    sum2 += y[j];
+    neg = y[j] < neg ? y[j] : neg;
+    best2 = xb[j] > best2 ? xb[j] : best2;
+  }
+
+  for(i = 0; i < (2 * dim1); i++) {
+    for(j = 0; j < dim2; j++) {
+      max = bimatrix[i][j] > max ? bimatrix[i][j] : max;
+      min = bimatrix[i][j] < min ? bimatrix[i][j] : min;
+    }
+  }
+
+  //The rounding errors of the sums can make the difference slightly negative
+  check->regret1 = best1 - u1 > 0.0 ? best1 - u1 : 0.0;
+  check->regret2 = best2 - u2 > 0.0 ? best2 - u2 : 0.0;
+  check->mass_error = fabs(sum1 - 1.0) > fabs(sum2 - 1.0) ? fabs(sum1 - 1.0) : fabs(sum2 - 1.0);
+  check->mass_error = -neg > check->mass_error ? -neg : check->mass_error;
+  check->scale = max - min > 0.0 ? max - min : 1.0;
+
+  free(x); free(y); free(ay); free(xb);
+
+  return check->regret1 <= VERIFY_TOL * check->scale && check->regret2 <= VERIFY_TOL * check->scale && check->mass_error <= VERIFY_TOL;
+}
+
+/*
+  Solves the indifference system of one player: the k opponent's strategies 'rows' must all get the
+  same payoff v from the k strategies 'cols' of the player, whose probabilities sum to 1. The payoff
+  of row r against column c is m[rows[r]][cols[c]], or m[cols[c]][rows[r]] when transposed.
+  Returns 0 if the system is singular.
+*/
+
+static int solve_indifference(double** m, int* rows, int* cols, int k, int transposed, long double* sol) {
+  int n = k + 1, i, j, r, best;
+  long double* a = (long double*) malloc(n * (n + 1) * sizeof(long double));
+  long double f, tmp;
+
+#define A(i,j) a[(i) * (n + 1) + (j)]
+
+  for(r = 0; r < k; r++) {
+    for(j = 0; j < k; j++)
+      A(r,j) = transposed ? m[cols[j]][rows[r]] : m[rows[r]][cols[j]];
+    A(r,k) = -1.0L;
+    A(r,n) = 0.0L;
+  }
+  for(j = 0; j < k; j++)
+    A(k,j) = 1.0L;
+  A(k,k) = 0.0L;
+  A(k,n) = 1.0L;
+
+  for(j = 0; j < n; j++) {
+    best = j;
+    for(i = j + 1; i < n; i++)
+      best = fabsl(A(i,j)) > fabsl(A(best,j)) ? i : best;
+    if( fabsl(A(best,j)) < 1e-300L ) {
+      free(a);
+      return 0;
+    }
+    if( best != j ) {
+      for(r = j; r <= n; r++) {
+	tmp = A(j,r); A(j,r) = A(best,r); A(best,r) = tmp;
+      }
+    }
+    for(i = j + 1; i < n; i++) {
+      f = A(i,j) / A(j,j);
+      for(r = j; r <= n; r++)
+	A(i,r) -= f * A(j,r);
+    }
+  }
+
+  for(j = n - 1; j >= 0; j--) {
+    tmp = A(j,n);
+    for(r = j + 1; r < n; r++)
+      tmp -= A(j,r) * sol[r];
+    sol[j] = tmp / A(j,j);
+  }
+
+#undef A
+
+  free(a);
+  return 1;
+}
+
+/*
+  The refined probabilities replace the old ones only if they are a valid pair of strategies and
+  do not increase the regret: in a degenerate game the supports may not define the equilibrium.
+*/
+
+int refine_equilibrium(double** bimatrix, int dim1, int dim2, equilibrium* eq) {
+  int k1 = 0, k2 = 0, i, valid = 1, changed = 0;
+  int *s1, *s2;
+  long double *p1, *p2;
+  double *old;
+  eq_check before, after;
+  equilibrium* e;
+
+  for(e = eq; e != 0; e = e->next) {
+    if( e->exact )
+      return 0;
+    if( e->label <= dim1 )
+      k1++;
+    else
+      k2++;
+  }
+  if( k1 == 0 || k1 != k2 )
+    return 0;
+
+  s1 = (int*) malloc(k1 * sizeof(int));
+  s2 = (int*) malloc(k2 * sizeof(int));
+  p1 = (long double*) malloc((k1 + 1) * sizeof(long double));
+  p2 = (long double*) malloc((k2 + 1) * sizeof(long double));
+  old = (double*) malloc((k1 + k2) * sizeof(double));
+
+  for(e = eq, k1 = 0, k2 = 0; e != 0; e = e->next) {
+    if( e->label <= dim1 )
+      s1[k1++] = e->label - 1;
+    else
+      s2[k2++] = e->label - dim1 - 1;
+  }
+
+  //The strategy of the second player makes the first one indifferent on his support, and vice versa
+  valid = solve_indifference(bimatrix,s1,s2,k1,0,p2) && solve_indifference(bimatrix + dim1,s2,s1,k1,1,p1);
+  for(i = 0; valid && i < k1; i++)
+    valid = p1[i] >= -VERIFY_TOL && p2[i] >= -VERIFY_TOL;
+
+  if( valid ) {
+    check_equilibrium(bimatrix,dim1,dim2,eq,&before);
+    for(e = eq, i = 0; e != 0; e = e->next, i++) {
+      old[i] = e->prob;
+      e->prob = e->label <= dim1 ? (double) p1[i] : (double) p2[i - k1];
+      e->prob = e->prob < 0.0 ? 0.0 : e->prob;
+    }
+    check_equilibrium(bimatrix,dim1,dim2,eq,&after);
+
+    if( after.regret1 + after.regret2 + after.mass_error * after.scale > before.regret1 + before.regret2 + before.mass_error * before.scale ) {
+      for(e = eq, i = 0; e != 0; e = e->next, i++)
+	e->prob = old[i];
+    }
+    else {
+      for(e = eq, i = 0; e != 0; e = e->next, i++)
+	changed |= e->prob != old[i];
+    }
+  }
+
+  free(s1); free(s2); free(p1); free(p2); free(old);
+  return changed;
+}
+
+void print_check(eq_check* check, int ok, FILE* f) {
+  fprintf(f,"Regret: %.3e (player 1) %.3e (player 2), probability error %.3e: %s\n",
+	  check->regret1,check->regret2,check->mass_error,ok ? "equilibrium verified" : "NOT AN EQUILIBRIUM");
+}
@@ -0,0 +1,35 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include "bimatrix.h"
+
+/*
+  Verification of the results: given the mixed strategies of an equilibrium, we compute the payoff
+  of every pure strategy of both players against them, directly on the bimatrix. The regret of a
+  player is what he would gain moving to his best pure response, so an equilibrium has regret 0
+  for both players, and an epsilon-equilibrium has regrets below epsilon.
+*/
+
+typedef struct eq_check_ {
+  double regret1;
+  double regret2;
+  double mass_error;  //Distance of the two strategies from probability distributions (negative or not summing to 1)
+  double scale;       //Largest difference between two payoffs of the game, the tolerance is relative to it
+} eq_check;
+
+//Results with a relative regret above this are reported as wrong
+#define VERIFY_TOL 1e-9
+
+//Rows of the bimatrix processed together in the matrix-vector products
+#define VERIFY_BLOCK 4
+
+//Computes the regrets of the equilibrium. Returns 1 if it is an equilibrium within VERIFY_TOL
+int check_equilibrium(double** bimatrix, int dim1, int dim2, equilibrium* eq, eq_check* check);
+
+//Solves again the indifference equations on the support of the equilibrium in extended precision. Returns 1 if the probabilities changed
+int refine_equilibrium(double** bimatrix, int dim1, int dim2, equilibrium* eq);
+
+//Prints the result of the check
+void print_check(eq_check* check, int ok, FILE* f);
+
+#endif